@@ -0,0 +1,38 @@
+#include <EZPROM.h>
+#include <EZAsyncStorage.h>
+
+#define UNIQUE_INT 4343
+
+//writes to the internal EEPROM in the background
+EZAsyncStorage async;
+EZPROM settings(async);
+
+const uint8_t gains_id = 0;
+float gains[3] = {1.0, 0.1, 0.01};
+EZAsyncStorage::Ticket saved;
+
+void setup() {
+  Serial.begin(9600);
+  if (settings.setup(UNIQUE_INT)) {
+    settings.save(gains_id, *gains, 3);
+  } else {
+    settings.load(gains_id, *gains);
+  }
+  saved = async.ticket();
+}
+
+void loop() {
+  if (Serial.available()) {
+    gains[0] = Serial.parseFloat();
+    //returns at once instead of after ~3.3 ms per changed byte
+    settings.save(gains_id, *gains, 3);
+    saved = async.ticket();
+  }
+  if (async.isDone(saved)) {
+    digitalWrite(LED_BUILTIN, HIGH);
+  } else {
+    digitalWrite(LED_BUILTIN, LOW);
+  }
+  //only needed on boards without the EEPROM ready interrupt
+  async.poll();
+}
@@ -0,0 +1,38 @@
+#include <Wire.h>
+#include <EZPROM.h>
+#include <EZI2CStorage.h>
+
+#define UNIQUE_INT 4242
+
+//a 24LC256 with A0-A2 tied low: 32 KB in 64 byte pages
+EZI2CStorage chip(32768, 64, 0x50);
+EZPROM external(chip);
+
+const uint8_t samples_id = 0;
+const uint16_t sample_amount = 256;
+int samples[sample_amount];
+
+void setup() {
+  Serial.begin(9600);
+  Wire.begin();
+
+  if (external.setup(UNIQUE_INT)) {
+    Serial.println("Formatted the external EEPROM.");
+  } else if (external.load(samples_id, *samples)) {
+    Serial.print("Last sample: ");
+    Serial.println(samples[sample_amount - 1]);
+  }
+
+  for (uint16_t i = 0; i < sample_amount; i++) {
+    samples[i] = analogRead(A0);
+  }
+  //512 bytes are written as 8 page writes instead of 512 byte writes
+  unsigned long start = millis();
+  external.save(samples_id, *samples, sample_amount);
+  Serial.print("Saved in ");
+  Serial.print(millis() - start);
+  Serial.println(" ms.");
+}
+
+void loop() {
+}
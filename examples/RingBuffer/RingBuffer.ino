@@ -0,0 +1,39 @@
+#include <EZPROM.h>
+#include <EZRing.h>
+
+#define UNIQUE_INT 4444
+
+struct Reading {
+public:
+    long time;
+    int value;
+};
+
+const uint8_t history_id = 0;
+//the last 32 readings; every append writes only the slot of the new reading
+EZRing<Reading> history(ezprom, history_id, 32);
+
+void setup() {
+    Serial.begin(9600);
+    ezprom.setup(UNIQUE_INT);
+    //finds the newest reading, or creates the ring on first use
+    history.begin();
+
+    Serial.println("Readings kept across resets: ");
+    for (uint16_t i = 0; i < history.size(); i++) {
+        Reading reading;
+        //reads one reading at a time, from the oldest to the newest
+        history.get(i, reading);
+        Serial.print(reading.time);
+        Serial.print(": ");
+        Serial.println(reading.value);
+    }
+}
+
+void loop() {
+    Reading reading;
+    reading.time = millis();
+    reading.value = analogRead(A0);
+    history.append(reading);
+    delay(60000);
+}
@@ -23,17 +23,17 @@ public:
         }
     }
 
-    virtual void serialize(uint8_t* stream, uint16_t & index) {
+    virtual void serialize(EZPROM::Writer & writer) {
         for (int i = 0; i < history_length; i++) {
-            //saves each reading object
-            putObject(* readings[i], stream, index);
+            //saves each reading object, straight to EEPROM
+            writer.putObject(* readings[i]);
         }
     }
 
-    virtual void deserialize(uint8_t* stream, uint16_t & index) {
+    virtual void deserialize(EZPROM::Reader & reader) {
         for (int i = 0; i < history_length; i++) {
-            //loads each reading object
-            getObject(* readings[i], stream, index);
+            //loads each reading object, straight from EEPROM
+            reader.getObject(* readings[i]);
         }
     }
 
@@ -0,0 +1,44 @@
+#include <EZPROM.h>
+#include <EZLog.h>
+
+#define UNIQUE_INT 12345
+
+//the first 768 bytes are used by ezprom for rarely changed settings,
+//the last 256 bytes by a wear-leveled log for a value saved every minute
+const uint16_t log_start = 768;
+const uint16_t log_length = 256;
+EZLog counters(log_start, log_length);
+
+//the ids of the log are separate from the ids of ezprom
+const uint8_t name_id = 0;
+const uint8_t uptime_id = 0;
+
+unsigned long uptimeMinutes = 0;
+
+void setup() {
+  Serial.begin(9600);
+
+  ezprom.setRegion(0, log_start);
+  if (ezprom.setup(UNIQUE_INT)) {
+    char name[] = "my board";
+    ezprom.save(name_id, *name, sizeof (name));
+  }
+
+  //mount the log, formatting it on first use
+  counters.setup();
+  counters.load(uptime_id, uptimeMinutes);
+
+  char name[16];
+  ezprom.load(name_id, *name);
+  Serial.print(name);
+  Serial.print(" has been running for ");
+  Serial.print(uptimeMinutes);
+  Serial.println(" minutes.");
+}
+
+void loop() {
+  delay(60000);
+  uptimeMinutes++;
+  //each save appends a new version, spreading the writes over the whole log
+  counters.save(uptime_id, uptimeMinutes);
+}
@@ -0,0 +1,475 @@
+// Host benchmark of EZPROM against the simulated EEPROM of extras/host.
+//
+// Sweeps the object count, the object size, the fill level of the device and
+// the operation mix for every engine mode and for EZLog, and reports one row
+// per run: host operations per second, modeled device time, bytes read and
+// written per operation, and the throughput of compaction. Every load is
+// checked against what was saved. The modeled numbers are deterministic, so
+// two builds can be compared row by row to catch regressions.
+//
+// Build and run from the root of the library:
+// g++ -std=gnu++11 -O2 -Iextras/host -Isrc src/*.cpp extras/host/*.cpp extras/benchmark/benchmark.cpp -o benchmark
+// ./benchmark > results.csv
+//
+// Options:
+//   --json            print a JSON array instead of CSV
+//   --quick           sweep fewer points, for a smoke run
+//   --device NAME     avr (default), fram or 24lc256
+//   --ops N           operations per run, 500 by default
+//
+// The directory format and the CRC width are chosen at compile time, so build
+// once per setting, for example with -DEZPROM_COMPACT_DIRECTORY=1 or
+// -DEZPROM_CRC_BITS=32; both are reported in every row.
+
+#include <EZPROM.h>
+#include <EZLog.h>
+#include <EZI2CStorage.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <chrono>
+#include <vector>
+
+namespace {
+
+// an engine mode, set up on a freshly reset EZPROM
+struct Mode {
+    const char * name;
+    void (*apply)(EZPROM & ezprom, uint16_t objectSize);
+    // true to run the operations on an EZLog over the whole device instead
+    bool log;
+};
+
+void applyDefault(EZPROM & ezprom, uint16_t objectSize) {
+    (void) ezprom;
+    (void) objectSize;
+}
+
+void applyCache(EZPROM & ezprom, uint16_t objectSize) {
+    (void) objectSize;
+    ezprom.enableCache();
+}
+
+void applyHoles(EZPROM & ezprom, uint16_t objectSize) {
+    (void) objectSize;
+    ezprom.setCompactOnRemove(false);
+    ezprom.setReuseHoles(true);
+}
+
+void applyCompression(EZPROM & ezprom, uint16_t objectSize) {
+    (void) objectSize;
+    ezprom.setCompression(true);
+}
+
+void applyWriteBack(EZPROM & ezprom, uint16_t objectSize) {
+    ezprom.enableWriteBack(8, 8 * objectSize);
+}
+
+const Mode MODES[] = {
+    {"default", applyDefault, false},
+    {"cache", applyCache, false},
+    {"holes", applyHoles, false},
+    {"compression", applyCompression, false},
+    {"writeback", applyWriteBack, false},
+    {"log", NULL, true},
+};
+
+// the share of each operation in a run, in percent
+struct Mix {
+    const char * name;
+    uint8_t loads;
+    uint8_t saves;
+    // saves with a different size
+    uint8_t resizes;
+    // removes, each followed by saving the object again
+    uint8_t removes;
+};
+
+const Mix MIXES[] = {
+    {"read", 100, 0, 0, 0},
+    {"update", 0, 100, 0, 0},
+    {"mixed", 70, 30, 0, 0},
+    {"churn", 20, 20, 30, 30},
+};
+
+const uint16_t COUNTS[] = {1, 4, 16, 64, 255};
+const uint16_t SIZES[] = {4, 32, 128};
+const uint8_t FILLS[] = {25, 50, 90};
+
+const uint16_t QUICK_COUNTS[] = {4, 64};
+const uint16_t QUICK_SIZES[] = {16};
+const uint8_t QUICK_FILLS[] = {50};
+
+// the largest object a run saves, see #nextSize
+const uint16_t MAX_SIZE = 128 + 128 / 2;
+
+struct Options {
+    bool json = false;
+    bool quick = false;
+    const char * device = "avr";
+    uint32_t ops = 500;
+};
+
+// what a run measured
+struct Result {
+    // false if the objects did not fit on the device, the rest is 0 then
+    bool filled;
+    uint32_t ops;
+    uint32_t failures;
+    // loads that returned other bytes than were saved, including the loads
+    // of every object at the end of the run
+    uint32_t mismatches;
+    double hostOpsPerSecond;
+    double modeledMicrosPerOp;
+    double writesPerOp;
+    double readsPerOp;
+    double writeCyclesPerOp;
+    uint32_t maxCellWrites;
+    uint32_t maxOpMicros;
+    // bytes moved per second of modeled time by a compact() after the run,
+    // see #measureCompaction
+    double compactionBytesPerSecond;
+};
+
+// a deterministic generator, so every build runs the same operations
+uint32_t randomState;
+
+uint32_t nextRandom() {
+    randomState ^= randomState << 13;
+    randomState ^= randomState >> 17;
+    randomState ^= randomState << 5;
+    return randomState;
+}
+
+// fills an object like a settings struct: a few varying bytes, mostly zeros
+void fillObject(uint8_t * object, uint16_t size) {
+    memset(object, 0, size);
+    for (uint16_t i = 0; i < size; i += 4) {
+        object[i] = nextRandom();
+    }
+}
+
+// a size around @size, for saves that change the size of an object
+uint16_t nextSize(uint16_t size) {
+    return size / 2 + 1 + nextRandom() % size;
+}
+
+// the block count with which an EZLog of @length bytes holds the most objects
+// of @size bytes while a block still fits the largest object of a run, see
+// #nextSize; 0 if the log cannot hold @count of them
+uint8_t getLogBlocks(uint16_t count, uint16_t size, uint16_t length) {
+    uint8_t best = 0;
+    uint16_t bestCapacity = 0;
+    for (uint16_t blocks = 2; blocks <= 255; blocks++) {
+        EZLog log(0, length, blocks);
+        uint16_t capacity = log.getCapacity(size);
+        if (log.getMaxObjectSize() >= size + size / 2 && capacity >= count && capacity > bestCapacity) {
+            best = blocks;
+            bestCapacity = capacity;
+        }
+    }
+    return best;
+}
+
+void prepare(EZPROM & ezprom, const Mode & mode, uint16_t size) {
+    ezprom.reset();
+    mode.apply(ezprom, size);
+}
+
+void prepare(EZLog & log, const Mode & mode, uint16_t size) {
+    (void) mode;
+    (void) size;
+    log.reset();
+}
+
+void resetStats(EZPROM & ezprom) {
+#if EZPROM_STATS
+    ezprom.resetStats();
+#else
+    (void) ezprom;
+#endif
+}
+
+void resetStats(EZLog & log) {
+    (void) log;
+}
+
+// writes what the run held back in RAM, then returns to the default settings
+void finish(EZPROM & ezprom) {
+    ezprom.flush();
+}
+
+void finish(EZLog & log) {
+    (void) log;
+}
+
+void settle(EZPROM & ezprom) {
+    ezprom.disableWriteBack();
+    ezprom.disableCache();
+}
+
+void settle(EZLog & log) {
+    (void) log;
+}
+
+uint32_t getMaxOpMicros(EZPROM & ezprom) {
+#if EZPROM_STATS
+    return ezprom.getStats().maxMicros;
+#else
+    (void) ezprom;
+    return 0;
+#endif
+}
+
+uint32_t getMaxOpMicros(EZLog & log) {
+    (void) log;
+    return 0;
+}
+
+// removes the first object and compacts, which moves every object behind it
+double measureCompaction(EZPROM & ezprom, EEPROMSim & sim) {
+#if EZPROM_STATS
+    ezprom.setCompactOnRemove(false);
+    ezprom.remove(0);
+    ezprom.resetStats();
+    uint32_t startMicros = sim.counters().modeledMicros;
+    ezprom.compact();
+    uint32_t micros = sim.counters().modeledMicros - startMicros;
+    return micros > 0 ? ezprom.getStats().compactionBytes * 1e6 / micros : 0;
+#else
+    (void) ezprom;
+    (void) sim;
+    return 0;
+#endif
+}
+
+// EZLog collects garbage while it saves, there is no compaction to measure
+double measureCompaction(EZLog & log, EEPROMSim & sim) {
+    (void) log;
+    (void) sim;
+    return 0;
+}
+
+template<typename Store> bool run(Store & store, EEPROMSim & sim, const Mode & mode, const Mix & mix,
+        uint16_t count, uint16_t size, uint32_t ops, Result & result) {
+    memset(&result, 0, sizeof (result));
+    sim.fill(0xFF);
+    prepare(store, mode, size);
+    uint8_t object[MAX_SIZE];
+    //the size of every object is tracked here, so looking it up costs nothing
+    uint16_t sizes[count];
+    //what every object should hold, unless a failed save left it unknown
+    std::vector<uint8_t> expected(count * MAX_SIZE);
+    bool known[count];
+    for (uint16_t id = 0; id < count; id++) {
+        fillObject(object, size);
+        if (!store.save(id, *object, size)) {
+            return false;
+        }
+        sizes[id] = size;
+        memcpy(&expected[id * MAX_SIZE], object, size);
+        known[id] = true;
+    }
+    finish(store);
+    sim.resetCounters();
+    resetStats(store);
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < ops; i++) {
+        uint8_t id = nextRandom() % count;
+        uint8_t roll = nextRandom() % 100;
+        uint16_t saved = 0;
+        bool done;
+        if (roll < mix.loads) {
+            done = store.load(id, *object);
+            if (done && known[id] && memcmp(object, &expected[id * MAX_SIZE], sizes[id]) != 0) {
+                result.mismatches++;
+            }
+        } else if (roll < mix.loads + mix.saves) {
+            //an object lost to a failed save is saved again with its old size
+            saved = sizes[id];
+            fillObject(object, saved);
+            done = store.save(id, *object, saved);
+        } else if (roll < mix.loads + mix.saves + mix.resizes) {
+            saved = nextSize(size);
+            fillObject(object, saved);
+            done = store.save(id, *object, saved);
+        } else {
+            store.remove(id);
+            saved = size;
+            fillObject(object, saved);
+            done = store.save(id, *object, saved);
+        }
+        if (saved > 0) {
+            //a failed save may leave the old version, or none
+            known[id] = done;
+            if (done) {
+                sizes[id] = saved;
+                memcpy(&expected[id * MAX_SIZE], object, saved);
+            }
+        }
+        if (!done) {
+            result.failures++;
+        }
+    }
+    //values held back by the write-back cache are part of the cost
+    finish(store);
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    settle(store);
+
+    const EEPROMSim::Counters & counters = sim.counters();
+    result.filled = true;
+    result.ops = ops;
+    result.hostOpsPerSecond = seconds > 0 ? ops / seconds : 0;
+    result.modeledMicrosPerOp = (double) counters.modeledMicros / ops;
+    result.writesPerOp = (double) counters.writes / ops;
+    result.readsPerOp = (double) counters.reads / ops;
+    result.writeCyclesPerOp = (double) counters.writeCycles / ops;
+    result.maxCellWrites = sim.maxCellWrites();
+    result.maxOpMicros = getMaxOpMicros(store);
+
+    //every object must hold what was last saved, also after a restart of the settings
+    for (uint16_t id = 0; id < count; id++) {
+        if (known[id] && (!store.load(id, *object) || memcmp(object, &expected[id * MAX_SIZE], sizes[id]) != 0)) {
+            result.mismatches++;
+        }
+    }
+    result.compactionBytesPerSecond = measureCompaction(store, sim);
+    return true;
+}
+
+void printHeader(const Options & options) {
+    if (options.json) {
+        printf("[\n");
+        return;
+    }
+    printf("device,directory,crc_bits,mode,mix,count,size,fill,length,status,ops,failures,mismatches,"
+            "host_ops_per_s,modeled_us_per_op,bytes_written_per_op,bytes_read_per_op,"
+            "write_cycles_per_op,max_cell_writes,max_op_us,compaction_bytes_per_s\n");
+}
+
+void printRow(const Options & options, bool first, const Mode & mode, const Mix & mix,
+        uint16_t count, uint16_t size, uint8_t fill, uint16_t length, const Result & result) {
+    const char * directory = EZPROM_COMPACT_DIRECTORY ? "compact" : "legacy";
+    //a run whose objects did not fit is reported too, so it is not mistaken for a skipped point
+    const char * status = result.filled ? "ok" : "fill_failed";
+    if (options.json) {
+        printf("%s  {\"device\": \"%s\", \"directory\": \"%s\", \"crc_bits\": %d, \"mode\": \"%s\", "
+                "\"mix\": \"%s\", \"count\": %u, \"size\": %u, \"fill\": %u, \"length\": %u, "
+                "\"status\": \"%s\", \"ops\": %lu, \"failures\": %lu, \"mismatches\": %lu, "
+                "\"host_ops_per_s\": %.0f, \"modeled_us_per_op\": %.1f, "
+                "\"bytes_written_per_op\": %.2f, \"bytes_read_per_op\": %.1f, \"write_cycles_per_op\": %.2f, "
+                "\"max_cell_writes\": %lu, \"max_op_us\": %lu, \"compaction_bytes_per_s\": %.0f}",
+                first ? "" : ",\n", options.device, directory, EZPROM_CRC_BITS, mode.name, mix.name,
+                count, size, fill, length, status, (unsigned long) result.ops, (unsigned long) result.failures,
+                (unsigned long) result.mismatches, result.hostOpsPerSecond, result.modeledMicrosPerOp,
+                result.writesPerOp, result.readsPerOp, result.writeCyclesPerOp, (unsigned long) result.maxCellWrites,
+                (unsigned long) result.maxOpMicros, result.compactionBytesPerSecond);
+        return;
+    }
+    printf("%s,%s,%d,%s,%s,%u,%u,%u,%u,%s,%lu,%lu,%lu,%.0f,%.1f,%.2f,%.1f,%.2f,%lu,%lu,%.0f\n",
+            options.device, directory, EZPROM_CRC_BITS, mode.name, mix.name, count, size, fill, length, status,
+            (unsigned long) result.ops, (unsigned long) result.failures, (unsigned long) result.mismatches,
+            result.hostOpsPerSecond, result.modeledMicrosPerOp, result.writesPerOp, result.readsPerOp,
+            result.writeCyclesPerOp, (unsigned long) result.maxCellWrites, (unsigned long) result.maxOpMicros,
+            result.compactionBytesPerSecond);
+}
+
+bool parseOptions(int argc, char ** argv, Options & options) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else if (strcmp(argv[i], "--quick") == 0) {
+            options.quick = true;
+        } else if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            options.device = argv[++i];
+        } else if (strcmp(argv[i], "--ops") == 0 && i + 1 < argc) {
+            options.ops = strtoul(argv[++i], NULL, 10);
+        } else {
+            return false;
+        }
+    }
+    return options.ops > 0 && (strcmp(options.device, "avr") == 0 || strcmp(options.device, "fram") == 0
+            || strcmp(options.device, "24lc256") == 0);
+}
+
+}
+
+int main(int argc, char ** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--json] [--quick] [--device avr|fram|24lc256] [--ops N]\n", argv[0]);
+        return 1;
+    }
+    const uint16_t * counts = options.quick ? QUICK_COUNTS : COUNTS;
+    uint8_t countAmount = options.quick ? sizeof (QUICK_COUNTS) / sizeof (QUICK_COUNTS[0]) : sizeof (COUNTS) / sizeof (COUNTS[0]);
+    const uint16_t * sizes = options.quick ? QUICK_SIZES : SIZES;
+    uint8_t sizeAmount = options.quick ? sizeof (QUICK_SIZES) / sizeof (QUICK_SIZES[0]) : sizeof (SIZES) / sizeof (SIZES[0]);
+    const uint8_t * fills = options.quick ? QUICK_FILLS : FILLS;
+    uint8_t fillAmount = options.quick ? sizeof (QUICK_FILLS) / sizeof (QUICK_FILLS[0]) : sizeof (FILLS) / sizeof (FILLS[0]);
+
+    //the internal EEPROM is the global one, an I2C chip sits on the host Wire bus
+    bool i2c = strcmp(options.device, "24lc256") == 0;
+    EEPROMSim chip(EZPROM_SIM_SIZE, EEPROMCostModel::I2C_24LC256);
+    EEPROMSim & sim = i2c ? chip : EEPROM;
+    if (strcmp(options.device, "fram") == 0) {
+        EEPROM.setCostModel(EEPROMCostModel::FRAM_FM25V02);
+    }
+    if (i2c) {
+        Wire.attach(chip);
+    }
+
+    printHeader(options);
+    bool first = true;
+    bool mismatched = false;
+    for (uint8_t c = 0; c < countAmount; c++) {
+        for (uint8_t s = 0; s < sizeAmount; s++) {
+            for (uint8_t f = 0; f < fillAmount; f++) {
+                //the device is sized so the objects fill it to the fill level
+                uint32_t used = EZPROM::getRequiredLength(counts[c], sizes[s]);
+                uint32_t length = used * 100 / fills[f];
+                //the 24LC256 holds 32 KB, the region length is 16 bits
+                if (length > (i2c ? 32768u : 65535u)) {
+                    continue;
+                }
+                sim.resize(length);
+                EZI2CStorage storage(length, 64);
+                //the log gets the blocks that leave the most room, see EZLog#getCapacity
+                uint8_t logBlocks = getLogBlocks(counts[c], sizes[s], length);
+                for (const Mode & mode : MODES) {
+                    for (const Mix & mix : MIXES) {
+                        //every run starts from the default settings
+                        EZPROM internal;
+                        EZPROM external(storage);
+                        EZLog internalLog(0, length, logBlocks);
+                        EZLog externalLog(storage, 0, length, logBlocks);
+                        randomState = 2463534242u;
+                        Result result;
+                        memset(&result, 0, sizeof (result));
+                        if (mode.log) {
+                            //a log that cannot hold the objects is reported like a full device
+                            if (logBlocks > 0) {
+                                    run(i2c ? externalLog : internalLog, sim, mode, mix, counts[c], sizes[s], options.ops, result);
+                            }
+                        } else {
+                            run(i2c ? external : internal, sim, mode, mix, counts[c], sizes[s], options.ops, result);
+                        }
+                        printRow(options, first, mode, mix, counts[c], sizes[s], fills[f], length, result);
+                        first = false;
+                        if (result.mismatches > 0) {
+                            mismatched = true;
+                        }
+                    }
+                }
+            }
+        }
+    }
+    if (options.json) {
+        printf("\n]\n");
+    }
+    if (mismatched) {
+        fprintf(stderr, "some loads returned other bytes than were saved, see the mismatches column\n");
+        return 2;
+    }
+    return 0;
+}
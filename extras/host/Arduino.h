@@ -0,0 +1,58 @@
+#ifndef EZPROM_HOST_ARDUINO_H
+#define EZPROM_HOST_ARDUINO_H
+
+/**
+ * A minimal stand-in for the Arduino core, used to build EZPROM on a Linux
+ * host against the simulated EEPROM in EEPROMSim.h. Only what EZPROM and its
+ * examples need is provided.
+ *
+ * Time is simulated: #micros and #millis return the modeled time spent by the
+ * simulated devices (plus any #delay calls), so measurements are deterministic.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#ifndef EZPROM_SIM_SIZE
+#define EZPROM_SIM_SIZE 1024
+#endif
+
+#ifndef E2END
+#define E2END (EZPROM_SIM_SIZE - 1)
+#endif
+
+#define PROGMEM
+#define pgm_read_byte(address) (*(const uint8_t *) (address))
+#define pgm_read_word(address) (*(const uint16_t *) (address))
+#define pgm_read_dword(address) (*(const uint32_t *) (address))
+
+//modeled time in microseconds, advanced by the simulated devices and #delay
+extern uint64_t hostMicros;
+
+inline unsigned long micros() {
+    return (unsigned long) hostMicros;
+}
+
+inline unsigned long millis() {
+    return (unsigned long) (hostMicros / 1000);
+}
+
+inline void delay(unsigned long ms) {
+    hostMicros += (uint64_t) ms * 1000;
+}
+
+inline void delayMicroseconds(unsigned int us) {
+    hostMicros += us;
+}
+
+inline void yield() {
+}
+
+#include "HardwareSerial.h"
+
+#endif /* EZPROM_HOST_ARDUINO_H */
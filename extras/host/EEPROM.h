@@ -0,0 +1,30 @@
+#ifndef EZPROM_HOST_EEPROM_H
+#define EZPROM_HOST_EEPROM_H
+
+#include "EEPROMSim.h"
+
+/**
+ * Host replacement for the Arduino EEPROM library. The global #EEPROM object
+ * is a simulated device, so it offers the usual read, write, update, get and
+ * put calls as well as the counters and cost model of #EEPROMSim.
+ */
+class EEPROMClass : public EEPROMSim {
+public:
+
+    template<typename T> T & get(int address, T & t) {
+        readBlock(address, &t, sizeof (T));
+        return t;
+    }
+
+    template<typename T> const T & put(int address, const T & t) {
+        const uint8_t * ram = (const uint8_t *) & t;
+        for (uint16_t i = 0; i < sizeof (T); i++) {
+            update(address + i, ram[i]);
+        }
+        return t;
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif /* EZPROM_HOST_EEPROM_H */
@@ -0,0 +1,150 @@
+#include "EEPROMSim.h"
+#include <stdio.h>
+
+uint64_t hostMicros = 0;
+
+const EEPROMCostModel EEPROMCostModel::AVR = {"avr", 500, 3300, 1, 100000};
+const EEPROMCostModel EEPROMCostModel::I2C_24LC256 = {"24lc256", 22500, 5000, 64, 1000000};
+const EEPROMCostModel EEPROMCostModel::I2C_24LC02 = {"24lc02", 22500, 5000, 8, 1000000};
+const EEPROMCostModel EEPROMCostModel::FRAM_FM25V02 = {"fm25v02", 200, 0, 0, 0xFFFFFFFF};
+
+EEPROMSim::EEPROMSim(uint16_t length, const EEPROMCostModel& model)
+: memory(NULL), writeCounts(NULL), size(0), model(model), pendingNanos(0) {
+    resize(length);
+}
+
+EEPROMSim::~EEPROMSim() {
+    free(memory);
+    free(writeCounts);
+}
+
+uint8_t EEPROMSim::read(int address) {
+    checkRange(address, 1);
+    stats.reads++;
+    spend(model.readNanos);
+    return memory[address];
+}
+
+void EEPROMSim::write(int address, uint8_t value) {
+    checkRange(address, 1);
+    stats.writeCycles++;
+    spend((uint64_t) model.writeCycleMicros * 1000);
+    program(address, value);
+}
+
+bool EEPROMSim::update(int address, uint8_t value) {
+    //the device is read to compare before writing, like EEPROM.update
+    if (read(address) == value) {
+        stats.skippedUpdates++;
+        return false;
+    }
+    write(address, value);
+    return true;
+}
+
+void EEPROMSim::readBlock(int address, void* dest, uint16_t length) {
+    uint8_t * ram = (uint8_t *) dest;
+    for (uint16_t i = 0; i < length; i++) {
+        ram[i] = read(address + i);
+    }
+}
+
+void EEPROMSim::writePage(int address, const void* src, uint16_t length) {
+    checkRange(address, length);
+    const uint8_t * ram = (const uint8_t *) src;
+    uint16_t pageSize = model.pageSize > 0 ? model.pageSize : length;
+    int lastPage = -1;
+    for (uint16_t i = 0; i < length; i++) {
+        int page = pageSize > 0 ? (address + i) / pageSize : 0;
+        if (page != lastPage) {
+            stats.writeCycles++;
+            spend((uint64_t) model.writeCycleMicros * 1000);
+            lastPage = page;
+        }
+        if (memory[address + i] != ram[i]) {
+            program(address + i, ram[i]);
+        }
+    }
+}
+
+uint16_t EEPROMSim::length() const {
+    return size;
+}
+
+void EEPROMSim::resize(uint16_t length) {
+    free(memory);
+    free(writeCounts);
+    size = length;
+    memory = (uint8_t *) malloc(length > 0 ? length : 1);
+    writeCounts = (uint32_t *) malloc(sizeof (uint32_t) * (length > 0 ? length : 1));
+    fill(0xFF);
+    resetCounters();
+}
+
+void EEPROMSim::fill(uint8_t value) {
+    memset(memory, value, size);
+}
+
+void EEPROMSim::setCostModel(const EEPROMCostModel& model) {
+    this->model = model;
+}
+
+const EEPROMCostModel& EEPROMSim::costModel() const {
+    return model;
+}
+
+const EEPROMSim::Counters& EEPROMSim::counters() const {
+    return stats;
+}
+
+void EEPROMSim::resetCounters() {
+    memset(&stats, 0, sizeof (stats));
+    memset(writeCounts, 0, sizeof (uint32_t) * size);
+    pendingNanos = 0;
+}
+
+uint32_t EEPROMSim::cellWrites(int address) const {
+    checkRange(address, 1);
+    return writeCounts[address];
+}
+
+uint32_t EEPROMSim::maxCellWrites() const {
+    uint32_t max = 0;
+    for (uint16_t i = 0; i < size; i++) {
+        if (writeCounts[i] > max) {
+            max = writeCounts[i];
+        }
+    }
+    return max;
+}
+
+uint32_t EEPROMSim::lifetimeRuns() const {
+    uint32_t max = maxCellWrites();
+    if (max == 0) {
+        return 0xFFFFFFFF;
+    }
+    return model.endurance / max;
+}
+
+void EEPROMSim::program(int address, uint8_t value) {
+    checkRange(address, 1);
+    stats.writes++;
+    writeCounts[address]++;
+    memory[address] = value;
+}
+
+void EEPROMSim::checkRange(int address, uint16_t length) const {
+    //an access outside the device is a bug in the code under test, which
+    //would otherwise corrupt the heap of the host silently
+    if (address < 0 || (uint32_t) address + length > size) {
+        fprintf(stderr, "EEPROMSim: access to %u bytes at %d, outside of %u bytes\n", length, address, size);
+        abort();
+    }
+}
+
+void EEPROMSim::spend(uint64_t nanos) {
+    nanos += pendingNanos;
+    stats.modeledMicros += nanos / 1000;
+    hostMicros += nanos / 1000;
+    pendingNanos = nanos % 1000;
+}
@@ -0,0 +1,104 @@
+#ifndef EZPROM_HOST_EEPROMSIM_H
+#define EZPROM_HOST_EEPROMSIM_H
+
+#include "Arduino.h"
+
+/**
+ * Describes how long a simulated device takes to do its work and how long it
+ * lasts. A write cycle programs up to #pageSize bytes, as long as they are in
+ * the same page; internal EEPROM programs one byte per cycle.
+ */
+struct EEPROMCostModel {
+    const char * name;
+    // time to read one byte, in nanoseconds
+    uint32_t readNanos;
+    // time of one write cycle, in microseconds
+    uint32_t writeCycleMicros;
+    // bytes programmed by one write cycle, 1 for byte-wise devices
+    uint16_t pageSize;
+    // rated write cycles per cell
+    uint32_t endurance;
+
+    // ATmega internal EEPROM: ~3.3 ms per byte, 100k cycles
+    static const EEPROMCostModel AVR;
+    // 24LC256 I2C EEPROM: 64 byte pages, 5 ms write cycle, 1M cycles
+    static const EEPROMCostModel I2C_24LC256;
+    // 24LC02 I2C EEPROM: 8 byte pages, 5 ms write cycle, 1M cycles
+    static const EEPROMCostModel I2C_24LC02;
+    // FM25V02 SPI FRAM: no write delay, practically unlimited endurance
+    static const EEPROMCostModel FRAM_FM25V02;
+};
+
+/**
+ * A simulated EEPROM device. It stores its contents in RAM and counts every
+ * access, so that the cost of EZPROM operations can be measured off-device:
+ * bytes read, bytes written, #update calls that were skipped because the byte
+ * did not change, write cycles, writes per cell and modeled time.
+ *
+ * New devices are filled with 0xFF, like erased EEPROM. An access outside of
+ * the device prints the address and aborts.
+ */
+class EEPROMSim {
+public:
+    struct Counters {
+        uint32_t reads;
+        uint32_t writes;
+        uint32_t skippedUpdates;
+        uint32_t writeCycles;
+        uint64_t modeledMicros;
+    };
+
+    EEPROMSim(uint16_t length = EZPROM_SIM_SIZE, const EEPROMCostModel & model = EEPROMCostModel::AVR);
+    ~EEPROMSim();
+
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    // writes @value only if it differs, returns true if a write happened
+    bool update(int address, uint8_t value);
+
+    void readBlock(int address, void * dest, uint16_t length);
+    /**
+     * Programs @length bytes starting at @address, one write cycle per page
+     * touched. Only bytes that differ are counted as written, but the cycle
+     * is paid for every page in the burst, like a real page write.
+     */
+    void writePage(int address, const void * src, uint16_t length);
+
+    uint16_t length() const;
+    // resizes the device, clearing its contents and counters
+    void resize(uint16_t length);
+    // sets every byte without counting the writes
+    void fill(uint8_t value);
+
+    void setCostModel(const EEPROMCostModel & model);
+    const EEPROMCostModel & costModel() const;
+
+    const Counters & counters() const;
+    void resetCounters();
+    // the number of times the cell at @address was written
+    uint32_t cellWrites(int address) const;
+    // the highest write count of any cell
+    uint32_t maxCellWrites() const;
+    /**
+     * Estimates how many times the workload measured since #resetCounters
+     * could run before the most worn cell reaches the rated endurance of the
+     * cost model.
+     */
+    uint32_t lifetimeRuns() const;
+
+private:
+    uint8_t * memory;
+    uint32_t * writeCounts;
+    uint16_t size;
+    EEPROMCostModel model;
+    Counters stats;
+    // modeled time below one microsecond not yet added to hostMicros
+    uint32_t pendingNanos;
+
+    void program(int address, uint8_t value);
+    // aborts if @length bytes at @address are not all on the device
+    void checkRange(int address, uint16_t length) const;
+    void spend(uint64_t nanos);
+};
+
+#endif /* EZPROM_HOST_EEPROMSIM_H */
@@ -0,0 +1,25 @@
+#ifndef EZPROM_HOST_HARDWARESERIAL_H
+#define EZPROM_HOST_HARDWARESERIAL_H
+
+#include "Stream.h"
+
+/**
+ * Host replacement for the Serial port of a board: what is printed goes to
+ * standard output, and nothing is ever received.
+ */
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud);
+
+    size_t write(uint8_t data);
+    size_t write(const uint8_t * buffer, size_t size);
+    using Print::write;
+
+    int available();
+    int read();
+    int peek();
+};
+
+extern HardwareSerial Serial;
+
+#endif /* EZPROM_HOST_HARDWARESERIAL_H */
@@ -0,0 +1,85 @@
+#include "Print.h"
+#include <string.h>
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t written = 0;
+    for (size_t i = 0; i < size; i++) {
+        written += write(buffer[i]);
+    }
+    return written;
+}
+
+size_t Print::write(const char* str) {
+    return write((const uint8_t *) str, strlen(str));
+}
+
+size_t Print::print(const char* str) {
+    return write(str);
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t) c);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long) value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(long value, int base) {
+    if (value < 0 && base == DEC) {
+        return print('-') + printNumber(-(unsigned long) value, base);
+    }
+    return printNumber((unsigned long) value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::println() {
+    return write("\r\n");
+}
+
+size_t Print::println(const char* str) {
+    return print(str) + println();
+}
+
+size_t Print::println(char c) {
+    return print(c) + println();
+}
+
+size_t Print::println(int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned int value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::println(unsigned long value, int base) {
+    return print(value, base) + println();
+}
+
+size_t Print::printNumber(unsigned long value, int base) {
+    //the digits are produced from the last one
+    char digits[8 * sizeof (unsigned long) + 1];
+    char * digit = digits + sizeof (digits) - 1;
+    *digit = '\0';
+    if (base < 2) {
+        base = DEC;
+    }
+    do {
+        uint8_t remainder = value % base;
+        value /= base;
+        *--digit = remainder < 10 ? '0' + remainder : 'A' + remainder - 10;
+    } while (value > 0);
+    return write(digit);
+}
@@ -0,0 +1,46 @@
+#ifndef EZPROM_HOST_PRINT_H
+#define EZPROM_HOST_PRINT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define DEC 10
+#define HEX 16
+
+/**
+ * Host replacement for the Print class of the Arduino core: a sink of bytes
+ * with the usual #print and #println overloads. Derived classes implement
+ * #write(uint8_t), and #write(const uint8_t *, size_t) if they can do better
+ * than a byte at a time.
+ */
+class Print {
+public:
+
+    virtual ~Print() {
+    }
+
+    virtual size_t write(uint8_t data) = 0;
+    virtual size_t write(const uint8_t * buffer, size_t size);
+
+    size_t write(const char * str);
+
+    size_t print(const char * str);
+    size_t print(char c);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+
+    size_t println();
+    size_t println(const char * str);
+    size_t println(char c);
+    size_t println(int value, int base = DEC);
+    size_t println(unsigned int value, int base = DEC);
+    size_t println(long value, int base = DEC);
+    size_t println(unsigned long value, int base = DEC);
+
+private:
+    size_t printNumber(unsigned long value, int base);
+};
+
+#endif /* EZPROM_HOST_PRINT_H */
@@ -0,0 +1,20 @@
+#ifndef EZPROM_HOST_STREAM_H
+#define EZPROM_HOST_STREAM_H
+
+#include "Print.h"
+
+/**
+ * Host replacement for the Stream class of the Arduino core: a #Print that
+ * can also be read from.
+ */
+class Stream : public Print {
+public:
+    // the amount of bytes that can be read
+    virtual int available() = 0;
+    // the next byte, or -1 if there is none
+    virtual int read() = 0;
+    // the next byte without consuming it, or -1 if there is none
+    virtual int peek() = 0;
+};
+
+#endif /* EZPROM_HOST_STREAM_H */
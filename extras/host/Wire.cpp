@@ -0,0 +1,129 @@
+#include "Wire.h"
+
+TwoWire Wire;
+
+// compared as a uint16_t, so a buffer of 256 bytes is not truncated
+static const uint16_t bufferLength = BUFFER_LENGTH;
+
+void TwoWire::begin() {
+}
+
+void TwoWire::setClock(uint32_t clock) {
+    (void) clock;
+}
+
+void TwoWire::attach(EEPROMSim& chip, uint8_t address) {
+    this->chip = &chip;
+    chipAddress = address;
+    busy = false;
+    pointer = 0;
+}
+
+uint8_t TwoWire::getAddressBytes() {
+    return chip->length() <= 2048 ? 1 : 2;
+}
+
+bool TwoWire::selects(uint8_t address, uint16_t& block) {
+    if (chip == NULL) {
+        return false;
+    }
+    if (getAddressBytes() == 1) {
+        if ((address & ~0x07) != chipAddress) {
+            return false;
+        }
+        block = (uint16_t) (address & 0x07) << 8;
+        return block < chip->length();
+    }
+    block = 0;
+    return address == chipAddress;
+}
+
+void TwoWire::beginTransmission(uint8_t address) {
+    target = address;
+    txLength = 0;
+}
+
+size_t TwoWire::write(uint8_t data) {
+    if (txLength == bufferLength) {
+        return 0;
+    }
+    txBuffer[txLength++] = data;
+    return 1;
+}
+
+size_t TwoWire::write(const uint8_t* data, size_t length) {
+    size_t written = 0;
+    while (written < length && write(data[written]) == 1) {
+        written++;
+    }
+    return written;
+}
+
+uint8_t TwoWire::endTransmission(bool stop) {
+    (void) stop;
+    uint16_t block;
+    if (!selects(target, block)) {
+        return 2;
+    }
+    if (busy) {
+        //a chip in a write cycle does not acknowledge, the cycle was already
+        //paid for by the page write, so the first poll ends it
+        busy = false;
+        return 2;
+    }
+    uint8_t addressBytes = getAddressBytes();
+    if (txLength < addressBytes) {
+        //an acknowledge poll
+        return 0;
+    }
+    pointer = block | txBuffer[addressBytes - 1];
+    if (addressBytes == 2) {
+        pointer |= (uint16_t) txBuffer[0] << 8;
+    }
+    pointer %= chip->length();
+    uint8_t dataLength = txLength - addressBytes;
+    if (dataLength == 0) {
+        //a dummy write that only sets the address counter, before a read
+        return 0;
+    }
+    //the chip rolls over within the page, like the real one
+    uint16_t pageSize = chip->costModel().pageSize > 0 ? chip->costModel().pageSize : chip->length();
+    uint16_t pageStart = pointer - pointer % pageSize;
+    uint16_t offset = pointer - pageStart;
+    const uint8_t * data = txBuffer + addressBytes;
+    uint16_t first = dataLength < pageSize - offset ? dataLength : pageSize - offset;
+    chip->writePage(pointer, data, first);
+    if (first < dataLength) {
+        chip->writePage(pageStart, data + first, dataLength - first);
+    }
+    busy = true;
+    return 0;
+}
+
+uint8_t TwoWire::requestFrom(uint8_t address, uint8_t quantity) {
+    rxLength = 0;
+    rxIndex = 0;
+    uint16_t block;
+    if (!selects(address, block) || busy) {
+        return 0;
+    }
+    uint16_t length = quantity < bufferLength ? quantity : bufferLength;
+    //sequential read, the address counter rolls over at the end of the chip
+    for (uint16_t i = 0; i < length; i++) {
+        rxBuffer[i] = chip->read(pointer);
+        pointer = (pointer + 1) % chip->length();
+    }
+    rxLength = length;
+    return (uint8_t) length;
+}
+
+int TwoWire::available() {
+    return rxLength - rxIndex;
+}
+
+int TwoWire::read() {
+    if (rxIndex == rxLength) {
+        return -1;
+    }
+    return rxBuffer[rxIndex++];
+}
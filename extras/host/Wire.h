@@ -0,0 +1,60 @@
+#ifndef EZPROM_HOST_WIRE_H
+#define EZPROM_HOST_WIRE_H
+
+#include "EEPROMSim.h"
+
+//the Wire buffer of the host bus, as large as on ESP32; AVR has 32 bytes
+#ifndef BUFFER_LENGTH
+#define BUFFER_LENGTH 128
+#endif
+
+/**
+ * Host replacement for the Arduino Wire library. Simulated 24LCxx EEPROM chips
+ * can be attached to the bus with #attach; they answer page writes, sequential
+ * reads and acknowledge polling like the real chips, and their costs are
+ * counted by their #EEPROMSim. Use the I2C cost models for realistic numbers:
+ * EEPROMSim chip(32768, EEPROMCostModel::I2C_24LC256);
+ * Wire.attach(chip);
+ */
+class TwoWire {
+public:
+    void begin();
+    void setClock(uint32_t clock);
+
+    // connects @chip at @address, chips of up to 2 KB also answer the 7 addresses above it
+    void attach(EEPROMSim & chip, uint8_t address = 0x50);
+
+    void beginTransmission(uint8_t address);
+    size_t write(uint8_t data);
+    size_t write(const uint8_t * data, size_t length);
+    // returns 0 on success, 2 if the chip did not acknowledge its address
+    uint8_t endTransmission(bool stop = true);
+
+    uint8_t requestFrom(uint8_t address, uint8_t quantity);
+    int available();
+    int read();
+
+private:
+    EEPROMSim * chip = NULL;
+    uint8_t chipAddress = 0;
+    // true while the chip is in a write cycle, until it is polled once
+    bool busy = false;
+    // the internal address counter of the chip
+    uint16_t pointer = 0;
+
+    uint8_t target = 0;
+    uint8_t txBuffer[BUFFER_LENGTH];
+    uint16_t txLength = 0;
+    uint8_t rxBuffer[BUFFER_LENGTH];
+    uint16_t rxLength = 0;
+    uint16_t rxIndex = 0;
+
+    // the amount of address bytes the chip expects
+    uint8_t getAddressBytes();
+    // true if @address selects the chip, sets the block bits of small chips in @block
+    bool selects(uint8_t address, uint16_t & block);
+};
+
+extern TwoWire Wire;
+
+#endif /* EZPROM_HOST_WIRE_H */
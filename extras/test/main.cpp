@@ -0,0 +1,50 @@
+// Runs the host unit tests, see the Makefile. Only the tests whose name
+// contains the first argument are run, if one is given.
+
+#include "test.h"
+
+TestCase * testCases = NULL;
+
+namespace {
+
+TestCase * lastCase = NULL;
+bool failed;
+
+}
+
+TestCase::TestCase(const char* name, void (*run)()) : name(name), run(run), next(NULL) {
+    if (lastCase == NULL) {
+        testCases = this;
+    } else {
+        lastCase->next = this;
+    }
+    lastCase = this;
+}
+
+void testFailed(const char* file, int line, const char* condition) {
+    printf("  %s:%d: CHECK(%s) failed\n", file, line, condition);
+    failed = true;
+}
+
+int main(int argc, char** argv) {
+    uint16_t run = 0;
+    uint16_t failures = 0;
+    for (TestCase * test = testCases; test != NULL; test = test->next) {
+        if (argc > 1 && strstr(test->name, argv[1]) == NULL) {
+            continue;
+        }
+        //every test starts on an erased device
+        EEPROM.setCostModel(EEPROMCostModel::AVR);
+        EEPROM.resize(EZPROM_SIM_SIZE);
+        failed = false;
+        test->run();
+        run++;
+        if (failed) {
+            printf("FAIL %s\n", test->name);
+            failures++;
+        }
+    }
+    printf("%u of %u tests passed (compact directory: %d, CRC bits: %d)\n",
+            run - failures, run, EZPROM_COMPACT_DIRECTORY, EZPROM_CRC_BITS);
+    return failures > 0 ? 1 : 0;
+}
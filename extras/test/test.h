@@ -0,0 +1,64 @@
+#ifndef EZPROM_TEST_H
+#define EZPROM_TEST_H
+
+/**
+ * A minimal unit test harness for the host build, see the Makefile. Every
+ * TEST registers itself when the program starts and is run by main() against
+ * a freshly erased simulated EEPROM of EZPROM_SIM_SIZE bytes. A CHECK that
+ * fails is reported and ends its test.
+ */
+
+#include <EZPROM.h>
+#include <stdio.h>
+
+struct TestCase {
+    const char * name;
+    void (*run)();
+    TestCase * next;
+
+    TestCase(const char * name, void (*run)());
+};
+
+// the registered tests, in the order they were registered
+extern TestCase * testCases;
+
+// reports a failed CHECK, see #CHECK
+void testFailed(const char * file, int line, const char * condition);
+
+#define TEST(name) \
+    static void name(); \
+    static TestCase name##Case(#name, name); \
+    static void name()
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            testFailed(__FILE__, __LINE__, #condition); \
+            return; \
+        } \
+    } while (0)
+
+// fills @size bytes of @data with a pattern that depends on @seed
+inline void fillPattern(uint8_t * data, uint16_t size, uint8_t seed) {
+    for (uint16_t i = 0; i < size; i++) {
+        data[i] = seed * 31 + i * 7;
+    }
+}
+
+// true if the object with @id holds @size bytes of the pattern of @seed
+inline bool hasPattern(EZPROM & ezprom, uint8_t id, uint16_t size, uint8_t seed) {
+    uint8_t expected[size];
+    uint8_t loaded[size];
+    fillPattern(expected, size, seed);
+    return ezprom.getObjectData(id).size == size && ezprom.load(id, *loaded)
+            && memcmp(expected, loaded, size) == 0 && ezprom.verify(id);
+}
+
+// saves @size bytes of the pattern of @seed under @id
+inline bool savePattern(EZPROM & ezprom, uint8_t id, uint16_t size, uint8_t seed) {
+    uint8_t data[size];
+    fillPattern(data, size, seed);
+    return ezprom.save(id, *data, size);
+}
+
+#endif /* EZPROM_TEST_H */
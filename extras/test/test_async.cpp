@@ -0,0 +1,88 @@
+// Writes queued in RAM and drained by poll on the host, see EZAsyncStorage.
+
+#include "test.h"
+#include <EZAsyncStorage.h>
+
+TEST(asyncQueuesUntilPolled) {
+    EZAsyncStorage async;
+    uint8_t data[8];
+    fillPattern(data, sizeof (data), 1);
+    EEPROM.resetCounters();
+    CHECK(async.update(100, data, sizeof (data)) == sizeof (data));
+    EZAsyncStorage::Ticket ticket = async.ticket();
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(async.pending() == sizeof (data));
+    CHECK(async.space() == EZPROM_ASYNC_QUEUE - sizeof (data));
+    CHECK(!async.isDone(ticket));
+
+    //reads see the queued bytes before they are written
+    uint8_t loaded[10];
+    async.read(99, loaded, sizeof (loaded));
+    CHECK(loaded[0] == 0xFF && loaded[9] == 0xFF);
+    CHECK(memcmp(loaded + 1, data, sizeof (data)) == 0);
+
+    //consecutive bytes are written by one poll
+    CHECK(!async.poll());
+    CHECK(async.pending() == 0);
+    CHECK(async.isDone(ticket));
+    CHECK(EEPROM.counters().writes == sizeof (data));
+    CHECK(EEPROM.read(100) == data[0] && EEPROM.read(107) == data[7]);
+    CHECK(!async.poll());
+}
+
+TEST(asyncWritesRequeuedByteOnce) {
+    EZAsyncStorage async;
+    uint8_t first = 1;
+    uint8_t second = 2;
+    async.update(5, &first, 1);
+    async.update(20, &first, 1);
+    async.update(5, &second, 1);
+    CHECK(async.pending() == 2);
+    //bytes that already hold the value are not queued
+    uint8_t erased = 0xFF;
+    CHECK(async.update(30, &erased, 1) == 0);
+    EEPROM.resetCounters();
+    while (async.poll()) {
+    }
+    CHECK(EEPROM.counters().writes == 2);
+    CHECK(EEPROM.read(5) == 2 && EEPROM.read(20) == 1);
+}
+
+TEST(asyncWaitsWhenQueueIsFull) {
+    EZAsyncStorage async;
+    uint8_t data[EZPROM_ASYNC_QUEUE + 16];
+    fillPattern(data, sizeof (data), 3);
+    //no byte may hold the erased value, or it would not be queued
+    for (uint16_t i = 0; i < sizeof (data); i++) {
+        data[i] &= 0x7F;
+    }
+    CHECK(async.update(0, data, sizeof (data)) == sizeof (data));
+    //the bytes that did not fit were queued once older ones were written
+    CHECK(async.pending() <= EZPROM_ASYNC_QUEUE);
+    CHECK(EEPROM.read(0) == data[0]);
+    async.waitAll();
+    CHECK(async.pending() == 0);
+    for (uint16_t i = 0; i < sizeof (data); i++) {
+        CHECK(EEPROM.read(i) == data[i]);
+    }
+}
+
+TEST(asyncBacksEZPROM) {
+    EZAsyncStorage async;
+    EZPROM ezprom(async);
+    ezprom.reset();
+    async.waitAll();
+    CHECK(savePattern(ezprom, 1, 12, 1));
+    CHECK(hasPattern(ezprom, 1, 12, 1));
+    EZAsyncStorage::Ticket saved = async.ticket();
+    {
+        //nothing reached EEPROM yet
+        EZPROM direct;
+        CHECK(!direct.exists(1));
+    }
+    while (async.poll()) {
+    }
+    CHECK(async.isDone(saved));
+    EZPROM direct;
+    CHECK(hasPattern(direct, 1, 12, 1));
+}
@@ -0,0 +1,69 @@
+// Batches of changes that write the directory once, see EZPROM#beginBatch.
+
+#include "test.h"
+
+TEST(batchWritesDirectoryOnCommit) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(ezprom.beginBatch());
+    for (uint8_t id = 2; id < 8; id++) {
+        CHECK(savePattern(ezprom, id, 10, id));
+    }
+
+    //a remount during the batch still finds the directory of before it
+    {
+        EZPROM mounted;
+        CHECK(mounted.getObjectAmount() == 1);
+        CHECK(hasPattern(mounted, 1, 10, 1));
+        CHECK(!mounted.exists(2));
+    }
+    CHECK(ezprom.getObjectAmount() == 7);
+    ezprom.remove(1);
+
+    ezprom.commitBatch();
+    CHECK(!ezprom.isCacheEnabled());
+    EZPROM mounted;
+    CHECK(mounted.getObjectAmount() == 6);
+    CHECK(!mounted.exists(1));
+    for (uint8_t id = 2; id < 8; id++) {
+        CHECK(hasPattern(mounted, id, 10, id));
+    }
+}
+
+TEST(batchWritesEachEntryOnce) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    //the amount of objects is the last byte of the directory
+    uint16_t directory = EEPROM.length() - 1;
+    EEPROM.resetCounters();
+    {
+        EZPROM::Batch batch(ezprom);
+        //nested batches are committed by the outermost one
+        CHECK(ezprom.beginBatch());
+        for (uint8_t round = 0; round < 20; round++) {
+            CHECK(savePattern(ezprom, 1, 10, round));
+        }
+        CHECK(savePattern(ezprom, 2, 10, 2));
+        ezprom.commitBatch();
+        CHECK(EEPROM.cellWrites(directory) == 0);
+    }
+    CHECK(EEPROM.cellWrites(directory) == 1);
+    CHECK(hasPattern(ezprom, 1, 10, 19));
+    CHECK(hasPattern(ezprom, 2, 10, 2));
+}
+
+TEST(batchLeftOpenIsCommittedOnDestroy) {
+    {
+        EZPROM ezprom;
+        ezprom.reset();
+        CHECK(ezprom.beginBatch());
+        CHECK(savePattern(ezprom, 1, 10, 1));
+        CHECK(savePattern(ezprom, 2, 20, 2));
+    }
+    EZPROM mounted;
+    CHECK(mounted.getObjectAmount() == 2);
+    CHECK(hasPattern(mounted, 1, 10, 1));
+    CHECK(hasPattern(mounted, 2, 20, 2));
+}
@@ -0,0 +1,123 @@
+// Several objects at once, see EZPROM#saveMany, EZPROM#loadMany and
+// EZPROM#removeMany.
+
+#include "test.h"
+
+TEST(saveManyWritesDirectoryOnce) {
+    EZPROM ezprom;
+    ezprom.reset();
+    uint8_t values[5][6];
+    EZPROM::Item items[5];
+    for (uint8_t i = 0; i < 5; i++) {
+        fillPattern(values[i], 6, i);
+        items[i] = EZPROM::item(i, *values[i], 6);
+    }
+    //the amount of objects is the last byte of the directory
+    uint16_t directory = EEPROM.length() - 1;
+    EEPROM.resetCounters();
+    CHECK(ezprom.saveMany(items, 5));
+    CHECK(EEPROM.cellWrites(directory) == 1);
+    EZPROM mounted;
+    for (uint8_t id = 0; id < 5; id++) {
+        CHECK(hasPattern(mounted, id, 6, id));
+    }
+}
+
+TEST(saveManyKeepsGoingAfterFailure) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setOverwriteIfSizeDifferent(false);
+    CHECK(savePattern(ezprom, 2, 4, 2));
+    uint8_t small[2][8];
+    fillPattern(small[0], 8, 10);
+    fillPattern(small[1], 8, 11);
+    uint8_t resized[6];
+    fillPattern(resized, 6, 12);
+    static uint8_t large[EZPROM_SIM_SIZE];
+    EZPROM::Item items[] = {
+        EZPROM::item(1, *small[0], 8),
+        //too large for the device
+        EZPROM::item(9, *large, sizeof (large)),
+        //a different size than the stored object
+        EZPROM::item(2, *resized, 6),
+        EZPROM::item(3, *small[1], 8)
+    };
+    CHECK(!ezprom.saveMany(items, 4));
+    EZPROM mounted;
+    CHECK(mounted.getObjectAmount() == 3);
+    CHECK(hasPattern(mounted, 1, 8, 10));
+    CHECK(!mounted.exists(9));
+    CHECK(hasPattern(mounted, 2, 4, 2));
+    CHECK(hasPattern(mounted, 3, 8, 11));
+}
+
+TEST(loadManyReadsDirectoryOnce) {
+    EZPROM ezprom;
+    ezprom.reset();
+    for (uint8_t id = 0; id < 30; id++) {
+        CHECK(savePattern(ezprom, id, 4, id));
+    }
+    uint8_t values[2][4] = {};
+    uint8_t tooSmall[2] = {0x55, 0x55};
+    EZPROM::Item items[] = {
+        EZPROM::item(29, *values[0], 4),
+        EZPROM::item(3, *tooSmall, 2),
+        EZPROM::item(17, *values[1], 4)
+    };
+    CHECK(ezprom.loadMany(items, 3) == 2);
+    uint8_t expected[4];
+    fillPattern(expected, 4, 29);
+    CHECK(memcmp(values[0], expected, 4) == 0);
+    fillPattern(expected, 4, 17);
+    CHECK(memcmp(values[1], expected, 4) == 0);
+    //an object larger than its item is not loaded
+    CHECK(tooSmall[0] == 0x55 && tooSmall[1] == 0x55);
+}
+
+TEST(cacheLoadManyReadsOnlyTheObjects) {
+    EZPROM ezprom;
+    ezprom.reset();
+    for (uint8_t id = 0; id < 30; id++) {
+        CHECK(savePattern(ezprom, id, 4, id));
+    }
+    CHECK(ezprom.enableCache());
+    uint8_t values[3][4] = {};
+    uint8_t missing[4] = {};
+    EZPROM::Item items[] = {
+        EZPROM::item(29, *values[0], 4),
+        EZPROM::item(3, *values[1], 4),
+        EZPROM::item(40, *missing, 4),
+        EZPROM::item(17, *values[2], 4)
+    };
+    CHECK(ezprom.loadMany(items, 0) == 0);
+    EEPROM.resetCounters();
+    CHECK(ezprom.loadMany(items, 4) == 3);
+    CHECK(EEPROM.counters().reads == 3 * 4);
+    uint8_t expected[4];
+    fillPattern(expected, 4, 29);
+    CHECK(memcmp(values[0], expected, 4) == 0);
+    fillPattern(expected, 4, 3);
+    CHECK(memcmp(values[1], expected, 4) == 0);
+    fillPattern(expected, 4, 17);
+    CHECK(memcmp(values[2], expected, 4) == 0);
+}
+
+TEST(removeManyCompactsOnce) {
+    EZPROM ezprom;
+    ezprom.reset();
+    for (uint8_t id = 0; id < 10; id++) {
+        CHECK(savePattern(ezprom, id, 12, id));
+    }
+    const uint8_t ids[] = {1, 4, 7, 42};
+    CHECK(ezprom.removeMany(ids, sizeof (ids)) == 3);
+    CHECK(ezprom.getObjectAmount() == 7);
+    CHECK(ezprom.getAddress(9) == 6 * 12);
+    CHECK(ezprom.removeBetween(8, 255) == 2);
+    for (uint8_t id = 0; id < 10; id++) {
+        bool kept = id != 1 && id != 4 && id != 7 && id < 8;
+        CHECK(ezprom.exists(id) == kept);
+        if (kept) {
+            CHECK(hasPattern(ezprom, id, 12, id));
+        }
+    }
+}
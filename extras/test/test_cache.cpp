@@ -0,0 +1,76 @@
+// The RAM directory cache, see EZPROM#enableCache.
+
+#include "test.h"
+
+TEST(cacheLoadsReadOnlyTheObject) {
+    EZPROM ezprom;
+    ezprom.reset();
+    for (uint8_t id = 0; id < 20; id++) {
+        CHECK(savePattern(ezprom, id, 2 + id % 5, id));
+    }
+    CHECK(ezprom.enableCache());
+    CHECK(hasPattern(ezprom, 19, 2 + 19 % 5, 19));
+
+    //the directory is in RAM now, so only the bytes of the object are read
+    EEPROM.resetCounters();
+    uint8_t value[8];
+    CHECK(ezprom.load(19, *value));
+    CHECK(ezprom.exists(7));
+    CHECK(!ezprom.exists(20));
+    CHECK(ezprom.getObjectAmount() == 20);
+    CHECK(EEPROM.counters().reads == 2 + 19 % 5);
+}
+
+TEST(cacheFollowsSavesAndRemoves) {
+    EZPROM cached;
+    EZPROM uncached;
+    cached.reset();
+    CHECK(cached.enableCache());
+    for (uint8_t round = 0; round < 60; round++) {
+        uint8_t id = round * 7 % 13;
+        if (round % 4 == 3) {
+            cached.remove(id);
+        } else {
+            CHECK(savePattern(cached, id, 1 + round % 23, round));
+        }
+        //both see the same directory
+        for (uint8_t i = 0; i < 13; i++) {
+            CHECK(cached.exists(i) == uncached.exists(i));
+            CHECK(cached.getAddress(i) == uncached.getAddress(i));
+            CHECK(cached.getObjectData(i).size == uncached.getObjectData(i).size);
+        }
+        CHECK(cached.getObjectAmount() == uncached.getObjectAmount());
+    }
+}
+
+TEST(cacheIsReadAgainWhenInvalidated) {
+    EZPROM cached;
+    EZPROM other;
+    cached.reset();
+    CHECK(cached.enableCache());
+    CHECK(savePattern(cached, 1, 4, 1));
+    CHECK(!cached.exists(2));
+
+    //a change made by other means is only seen once the cache is invalidated
+    CHECK(savePattern(other, 2, 4, 2));
+    cached.invalidateCache();
+    CHECK(cached.exists(2));
+    CHECK(hasPattern(cached, 2, 4, 2));
+    CHECK(cached.refreshCache());
+    CHECK(cached.getObjectAmount() == 2);
+}
+
+TEST(cacheStaysCoherentWhenDisabled) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(ezprom.enableCache());
+    CHECK(ezprom.isCacheEnabled());
+    CHECK(savePattern(ezprom, 3, 10, 3));
+    ezprom.disableCache();
+    CHECK(!ezprom.isCacheEnabled());
+    CHECK(hasPattern(ezprom, 3, 10, 3));
+    CHECK(savePattern(ezprom, 4, 10, 4));
+    CHECK(ezprom.enableCache());
+    CHECK(hasPattern(ezprom, 4, 10, 4));
+    CHECK(ezprom.getObjectAmount() == 2);
+}
@@ -0,0 +1,116 @@
+// Compressed objects, see EZPROM#setCompression.
+
+#include "test.h"
+
+namespace {
+
+struct Table {
+    uint16_t values[64];
+    uint8_t mode;
+};
+
+// streams a run of repeated bytes, so it compresses well
+class Runs : public EZPROM::Serializable {
+public:
+    uint8_t data[150];
+
+    void serialize(EZPROM::Writer & writer) {
+        writer.write(data, sizeof (data));
+    }
+
+    void deserialize(EZPROM::Reader & reader) {
+        reader.read(data, sizeof (data));
+    }
+
+    uint16_t size() {
+        return sizeof (data);
+    }
+};
+
+bool isCompressed(EZPROM & ezprom, uint8_t id) {
+    return ezprom.getObjectData(id).flags & EZPROM::COMPRESSED_FLAG;
+}
+
+}
+
+TEST(compressedObjectsRoundTrip) {
+    Table table;
+    memset(&table, 0, sizeof (table));
+    for (uint8_t i = 0; i < 64; i++) {
+        table.values[i] = i / 16;
+    }
+    table.mode = 3;
+    uint8_t zeros[100] = {};
+    {
+        EZPROM ezprom;
+        ezprom.reset();
+        ezprom.setCompression(true);
+        CHECK(ezprom.save(1, table));
+        CHECK(ezprom.save(2, *zeros, sizeof (zeros)));
+        CHECK(isCompressed(ezprom, 1));
+        CHECK(isCompressed(ezprom, 2));
+        CHECK(ezprom.getObjectData(1).size < sizeof (table));
+        CHECK(ezprom.getObjectData(2).size < sizeof (zeros));
+        //an object that does not get smaller is stored as it is
+        CHECK(savePattern(ezprom, 3, 100, 3));
+        CHECK(!isCompressed(ezprom, 3));
+        CHECK(hasPattern(ezprom, 3, 100, 3));
+    }
+    //compressed objects load without enabling compression
+    EZPROM ezprom;
+    Table loaded;
+    CHECK(ezprom.load(1, loaded));
+    CHECK(memcmp(&loaded, &table, sizeof (table)) == 0);
+    uint8_t loadedZeros[100];
+    memset(loadedZeros, 0xFF, sizeof (loadedZeros));
+    CHECK(ezprom.load(2, *loadedZeros));
+    CHECK(memcmp(loadedZeros, zeros, sizeof (zeros)) == 0);
+    CHECK(ezprom.verify(1) && ezprom.verify(2));
+}
+
+TEST(compressedSerializableRoundTrips) {
+    Runs saved;
+    for (uint8_t i = 0; i < sizeof (saved.data); i++) {
+        saved.data[i] = i / 10;
+    }
+    {
+        EZPROM ezprom;
+        ezprom.reset();
+        ezprom.setCompression(true);
+        CHECK(ezprom.saveSerial(1, &saved));
+        CHECK(isCompressed(ezprom, 1));
+        CHECK(ezprom.getObjectData(1).size < sizeof (saved.data));
+    }
+    EZPROM ezprom;
+    Runs loaded;
+    CHECK(ezprom.loadSerial(1, &loaded));
+    CHECK(memcmp(loaded.data, saved.data, sizeof (saved.data)) == 0);
+}
+
+TEST(compressedObjectWithCorruptSizeIsRejected) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompression(true);
+    Runs saved;
+    memset(saved.data, 7, sizeof (saved.data));
+    CHECK(ezprom.saveSerial(1, &saved));
+    CHECK(isCompressed(ezprom, 1));
+    uint16_t packed = ezprom.getObjectData(1).size;
+
+    //the uncompressed size leads the object
+    uint16_t address = ezprom.getAddress(1);
+    EEPROM.write(address, 0xFF);
+    EEPROM.write(address + 1, 0xFF);
+    Runs loaded;
+    CHECK(!ezprom.loadSerial(1, &loaded));
+    static uint8_t buffer[EZPROM::MAX_OBJECT_SIZE];
+    CHECK(!ezprom.load(1, *buffer));
+
+    //too large for what the compressed bytes can hold
+    uint16_t size = packed * 200;
+    CHECK(size <= EZPROM::MAX_OBJECT_SIZE);
+    EEPROM.write(address, size);
+    EEPROM.write(address + 1, size >> 8);
+    CHECK(!ezprom.loadSerial(1, &loaded));
+    CHECK(!ezprom.load(1, *buffer));
+}
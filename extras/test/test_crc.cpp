@@ -0,0 +1,96 @@
+// The CRC kept with every object, see EZPROM_CRC_BITS and EZPROM#verify.
+
+#include "test.h"
+#include <EZRing.h>
+
+#if EZPROM_CRC_BITS > 0
+
+TEST(verifyFindsCorruption) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 40, 1));
+    CHECK(ezprom.verify(1));
+    uint16_t address = ezprom.getAddress(1) + 17;
+    EEPROM.write(address, EEPROM.read(address) ^ 0x10);
+    CHECK(!ezprom.verify(1));
+    CHECK(savePattern(ezprom, 1, 40, 2));
+    CHECK(ezprom.verify(1));
+}
+
+TEST(unchangedSaveWritesNothing) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(ezprom.enableCache());
+    CHECK(savePattern(ezprom, 1, 64, 1));
+    EEPROM.resetCounters();
+    CHECK(savePattern(ezprom, 1, 64, 1));
+    CHECK(EEPROM.counters().writes == 0);
+#if EZPROM_CRC_BITS == 32
+    //the CRCs match, so the object is not even read
+    CHECK(EEPROM.counters().reads == 0);
+#else
+    CHECK(EEPROM.counters().reads == 64);
+#endif
+}
+
+TEST(saveRangeLeavesCrcStaleUntilFlush) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 40, 1));
+    CHECK(savePattern(ezprom, 2, 40, 2));
+    uint32_t value = 0x12345678;
+    CHECK(ezprom.saveRange(1, 8, value));
+    CHECK(ezprom.getObjectData(1).flags & EZPROM::STALE_CRC_FLAG);
+
+    //later writes only write the range
+    value = 0x87654321;
+    EEPROM.resetCounters();
+    CHECK(ezprom.saveRange(1, 8, value));
+    CHECK(EEPROM.counters().writes <= sizeof (value));
+
+    //a restart keeps the mark, flush updates the CRC
+    EZPROM restarted;
+    CHECK(restarted.flush());
+    CHECK(!(restarted.getObjectData(1).flags & EZPROM::STALE_CRC_FLAG));
+    CHECK(restarted.verify(1));
+    CHECK(hasPattern(restarted, 2, 40, 2));
+    uint16_t address = restarted.getAddress(1);
+    EEPROM.write(address, EEPROM.read(address) ^ 0x01);
+    CHECK(!restarted.verify(1));
+}
+
+TEST(removedStaleObjectIsNoJournal) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    for (uint8_t id = 0; id < 4; id++) {
+        CHECK(savePattern(ezprom, id, 30, id));
+    }
+    uint8_t value = 0;
+    CHECK(ezprom.saveRange(1, 0, value));
+    ezprom.remove(1);
+    CHECK(ezprom.getObjectData(1).size == 0);
+    EZPROM restarted;
+    CHECK(hasPattern(restarted, 2, 30, 2));
+    while (restarted.tick(8)) {
+    }
+    CHECK(restarted.getAddress(2) == 30);
+    CHECK(hasPattern(restarted, 3, 30, 3));
+}
+
+#endif
+
+TEST(ringAppendWritesOnlyItsSlot) {
+    EZPROM ezprom;
+    ezprom.reset();
+    EZRing<uint32_t> ring(ezprom, 1, 16);
+    CHECK(ring.begin());
+    CHECK(ring.append(1));
+    for (uint32_t i = 2; i < 40; i++) {
+        EEPROM.resetCounters();
+        CHECK(ring.append(i * 0x01010101));
+        CHECK(EEPROM.counters().writes <= EZRing<uint32_t>::SLOT_SIZE);
+    }
+    CHECK(ezprom.flush());
+    CHECK(ezprom.verify(1));
+}
@@ -0,0 +1,217 @@
+// The directory formats, see EZPROM_COMPACT_DIRECTORY and
+// EZPROM#migrateDirectory.
+
+#include "test.h"
+
+namespace {
+
+// a directory entry without EZPROM_COMPACT_DIRECTORY, laid out like the
+// compiler lays out EZPROM's own
+struct LegacyEntry {
+    uint8_t id;
+    uint16_t size;
+#if EZPROM_CRC_BITS > 0
+    EZPROM::Crc crc;
+#endif
+};
+
+#if EZPROM_CRC_BITS > 0
+EZPROM::Crc getCrc(const uint8_t * data, uint16_t size) {
+#if EZPROM_CRC_BITS == 32
+    return EZCrc::crc32(data, size);
+#elif EZPROM_CRC_BITS == 16
+    return EZCrc::crc16(data, size);
+#else
+    return EZCrc::crc8(data, size);
+#endif
+}
+#endif
+
+// writes a legacy directory holding objects of @sizes, the one at @dead removed
+void writeLegacy(const uint16_t * sizes, uint8_t amount, uint8_t dead) {
+    uint16_t address = 0;
+    uint16_t cursor = EEPROM.length() - 1 - sizeof (LegacyEntry) * amount;
+    for (uint8_t i = 0; i < amount; i++) {
+        uint8_t data[sizes[i]];
+        fillPattern(data, sizes[i], i);
+        for (uint16_t j = 0; j < sizes[i]; j++) {
+            EEPROM.write(address++, data[j]);
+        }
+        LegacyEntry entry;
+        memset(&entry, 0, sizeof (entry));
+        entry.id = i;
+        entry.size = sizes[i] | (i == dead ? (uint16_t) EZPROM::DEAD_FLAG << 13 : 0);
+#if EZPROM_CRC_BITS > 0
+        entry.crc = getCrc(data, sizes[i]);
+#endif
+        EEPROM.put(cursor, entry);
+        cursor += sizeof (entry);
+    }
+    EEPROM.write(EEPROM.length() - 1, amount);
+}
+
+}
+
+TEST(sizesRoundTripInEveryEntryWidth) {
+    EEPROM.resize(8192);
+    EZPROM ezprom;
+    ezprom.reset();
+    //the compact format stores these in 0, 1, 1, 1 and 2 extra size bytes
+    const uint16_t sizes[] = {7, 8, 255, 2047, 2048};
+    for (uint8_t id = 0; id < 5; id++) {
+        CHECK(savePattern(ezprom, id, sizes[id], id));
+    }
+    EZPROM restarted;
+    for (uint8_t id = 0; id < 5; id++) {
+        CHECK(hasPattern(restarted, id, sizes[id], id));
+    }
+    restarted.remove(2);
+    CHECK(hasPattern(restarted, 4, 2048, 4));
+    CHECK(restarted.getAddress(4) == 7 + 8 + 2047);
+}
+
+TEST(directoryEntriesTakeTheDocumentedSpace) {
+    EEPROM.resize(256);
+    EZPROM ezprom;
+    ezprom.reset();
+    uint16_t value = 0x1234;
+    uint16_t amount = 0;
+    while (amount < 255 && ezprom.save(amount, value)) {
+        amount++;
+    }
+#if EZPROM_COMPACT_DIRECTORY
+    //an id and a head byte per small object, then 2 marker bytes and the amount
+    uint16_t entry = 2 + EZPROM_CRC_BITS / 8;
+    CHECK(amount == (256 - 3) / (sizeof (value) + entry));
+#else
+    CHECK(amount == (256 - 1) / (sizeof (value) + sizeof (LegacyEntry)));
+#endif
+}
+
+TEST(requiredLengthHoldsTheObjects) {
+    const uint16_t sizes[] = {2, 7, 8, 100, 300};
+    for (uint8_t i = 0; i < 5; i++) {
+        uint8_t amount = 600 / sizes[i] + 1;
+        uint16_t length = EZPROM::getRequiredLength(amount, sizes[i]);
+        EEPROM.resize(length);
+        EZPROM ezprom;
+        ezprom.reset();
+        for (uint8_t id = 0; id < amount; id++) {
+            CHECK(savePattern(ezprom, id, sizes[i], id));
+        }
+        //one byte less and the last object does not fit
+        EEPROM.resize(length - 1);
+        ezprom.reset();
+        for (uint8_t id = 0; id + 1 < amount; id++) {
+            CHECK(savePattern(ezprom, id, sizes[i], id));
+        }
+        CHECK(!savePattern(ezprom, amount - 1, sizes[i], amount - 1));
+    }
+}
+
+#if EZPROM_COMPACT_DIRECTORY
+
+TEST(migrationKeepsLegacyObjects) {
+    const uint16_t sizes[] = {2, 30, 300, 9, 2};
+    writeLegacy(sizes, 5, 3);
+    EZPROM ezprom;
+    CHECK(ezprom.migrateDirectory());
+    for (uint8_t id = 0; id < 5; id++) {
+        CHECK(ezprom.exists(id) == (id != 3));
+        if (id != 3) {
+            CHECK(hasPattern(ezprom, id, sizes[id], id));
+        }
+    }
+    //objects stay where they are, the removed one as a hole
+    CHECK(ezprom.getAddress(4) == 2 + 30 + 300 + 9);
+    CHECK(ezprom.migrateDirectory());
+    ezprom.compact();
+    CHECK(hasPattern(ezprom, 4, 2, 4));
+    CHECK(ezprom.getAddress(4) == 2 + 30 + 300);
+}
+
+TEST(setupMigratesBeforeValidating) {
+    const uint16_t sizes[] = {20, 2};
+    writeLegacy(sizes, 2, 2);
+    //the second object is the unique int, saved under its own id
+    LegacyEntry entry;
+    uint16_t cursor = EEPROM.length() - 1 - sizeof (LegacyEntry);
+    EEPROM.get(cursor, entry);
+    entry.id = UNIQUE_INT_ID;
+    EEPROM.put(cursor, entry);
+    uint16_t uniqueInt = 0;
+    EEPROM.get(20, uniqueInt);
+
+    EZPROM ezprom;
+    CHECK(!ezprom.setup(uniqueInt));
+    CHECK(hasPattern(ezprom, 0, 20, 0));
+    CHECK(ezprom.isValid(uniqueInt));
+}
+
+#if EZPROM_CRC_BITS >= 16
+
+TEST(migrationKeepsLegacyDirectoryEndingInMarker) {
+    const uint16_t sizes[] = {10, 6, 4};
+    writeLegacy(sizes, 3, 3);
+    //find a last object whose CRC ends the directory in the marker bytes
+    uint32_t value = 0;
+    LegacyEntry entry;
+    uint16_t cursor = EEPROM.length() - 1 - sizeof (LegacyEntry);
+    EEPROM.get(cursor, entry);
+    do {
+        value++;
+        entry.crc = getCrc((const uint8_t *) &value, sizeof (value));
+    } while ((uint16_t) (entry.crc >> (EZPROM_CRC_BITS - 16)) != 0x5AA5);
+    EEPROM.put(10 + 6, value);
+    EEPROM.put(cursor, entry);
+    CHECK(EEPROM.read(EEPROM.length() - 3) == 0xA5);
+    CHECK(EEPROM.read(EEPROM.length() - 2) == 0x5A);
+
+    EZPROM ezprom;
+    CHECK(ezprom.migrateDirectory());
+    CHECK(ezprom.getObjectAmount() == 3);
+    CHECK(hasPattern(ezprom, 0, 10, 0));
+    CHECK(hasPattern(ezprom, 1, 6, 1));
+    uint32_t loaded = 0;
+    CHECK(ezprom.load(2, loaded));
+    CHECK(loaded == value);
+    CHECK(ezprom.verify(2));
+}
+
+#endif
+
+TEST(compactDirectoryIsNotMigratedAgain) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    ezprom.remove(1);
+    CHECK(savePattern(ezprom, 3, 30, 3));
+    EEPROM.resetCounters();
+    EZPROM restarted;
+    CHECK(restarted.migrateDirectory());
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(hasPattern(restarted, 2, 20, 2));
+    CHECK(hasPattern(restarted, 3, 30, 3));
+}
+
+TEST(migrationRejectsErasedDevice) {
+    EZPROM ezprom;
+    CHECK(!ezprom.migrateDirectory());
+    CHECK(ezprom.setup(77));
+    CHECK(ezprom.isValid(77));
+    CHECK(!ezprom.setup(77));
+}
+
+#else
+
+TEST(migrationKeepsLegacyDirectory) {
+    const uint16_t sizes[] = {2, 30};
+    writeLegacy(sizes, 2, 2);
+    EZPROM ezprom;
+    CHECK(ezprom.migrateDirectory());
+    CHECK(hasPattern(ezprom, 0, 2, 0));
+    CHECK(hasPattern(ezprom, 1, 30, 1));
+}
+
+#endif
@@ -0,0 +1,95 @@
+// Reusing the holes left by removed objects, see EZPROM#setReuseHoles.
+
+#include "test.h"
+
+namespace {
+
+// the objects 1 to 5 of 40, 8, 20, 8 and 8 bytes, with holes at 1 and 3
+void saveWithHoles(EZPROM & ezprom) {
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    ezprom.setReuseHoles(true);
+    const uint16_t sizes[] = {40, 8, 20, 8, 8};
+    for (uint8_t id = 1; id <= 5; id++) {
+        savePattern(ezprom, id, sizes[id - 1], id);
+    }
+    ezprom.remove(1);
+    ezprom.remove(3);
+}
+
+}
+
+TEST(newObjectFillsHoleOfItsSize) {
+    EZPROM ezprom;
+    saveWithHoles(ezprom);
+    CHECK(savePattern(ezprom, 6, 20, 6));
+    CHECK(ezprom.getAddress(6) == 48);
+    CHECK(savePattern(ezprom, 7, 40, 7));
+    CHECK(ezprom.getAddress(7) == 0);
+    //nothing was moved or appended
+    CHECK(ezprom.getAddress(5) == 76);
+    for (uint8_t id = 2; id <= 7; id++) {
+        CHECK(id == 3 || ezprom.exists(id));
+    }
+    CHECK(hasPattern(ezprom, 6, 20, 6));
+    CHECK(hasPattern(ezprom, 7, 40, 7));
+    CHECK(hasPattern(ezprom, 5, 8, 5));
+}
+
+TEST(resizedObjectMovesIntoHole) {
+    EZPROM ezprom;
+    saveWithHoles(ezprom);
+    //object 4 grows to the size of the first hole, its old place becomes one
+    CHECK(savePattern(ezprom, 4, 40, 44));
+    CHECK(ezprom.getAddress(4) == 0);
+    CHECK(ezprom.getAddress(5) == 76);
+    CHECK(hasPattern(ezprom, 4, 40, 44));
+    //the hole of 20 bytes and the old place of object 4 make a run of 28
+    CHECK(savePattern(ezprom, 8, 8, 8));
+    CHECK(ezprom.getAddress(8) == 48);
+    CHECK(savePattern(ezprom, 9, 20, 9));
+    CHECK(ezprom.getAddress(9) == 56);
+    CHECK(hasPattern(ezprom, 8, 8, 8));
+    CHECK(hasPattern(ezprom, 9, 20, 9));
+    CHECK(hasPattern(ezprom, 2, 8, 2));
+    CHECK(hasPattern(ezprom, 5, 8, 5));
+}
+
+TEST(fullDeviceSplitsSmallestHole) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    ezprom.setReuseHoles(true);
+    const uint16_t sizes[] = {40, 8, 20, 8, 8};
+    for (uint8_t id = 1; id <= 5; id++) {
+        CHECK(savePattern(ezprom, id, sizes[id - 1], id));
+    }
+    //fill the device up to the last byte, then free just enough room for the
+    //entry of a split hole
+    uint8_t id = 10;
+    while (savePattern(ezprom, id, 50, id)) {
+        id++;
+    }
+    ezprom.remove(--id);
+    while (savePattern(ezprom, id, 1, id)) {
+        id++;
+    }
+    CHECK(ezprom.getObjectData(id - 1).size == 1);
+    ezprom.remove(--id);
+    ezprom.remove(1);
+    ezprom.remove(3);
+    uint16_t last = ezprom.getAddress(id - 1);
+
+    //12 bytes do not fit behind the last object, but in both holes: the
+    //smaller one is split
+    CHECK(savePattern(ezprom, 200, 12, 200));
+    CHECK(ezprom.getAddress(200) == 48);
+    CHECK(ezprom.getAddress(id - 1) == last);
+    CHECK(hasPattern(ezprom, 200, 12, 200));
+    CHECK(hasPattern(ezprom, 10, 50, 10));
+    CHECK(hasPattern(ezprom, id - 1, 1, id - 1));
+    //the rest of the hole takes an object of its size
+    CHECK(savePattern(ezprom, 201, 8, 201));
+    CHECK(ezprom.getAddress(201) == 60);
+    CHECK(ezprom.getAddress(id - 1) == last);
+}
@@ -0,0 +1,33 @@
+// External I2C EEPROM, see EZI2CStorage. The compact build uses a Wire buffer
+// of 256 bytes, more than one transaction moves.
+
+#include "test.h"
+#include <Wire.h>
+#include <EZI2CStorage.h>
+
+TEST(i2cRoundTripsLargeObject) {
+    static EEPROMSim chip(32768, EEPROMCostModel::I2C_24LC256);
+    chip.resize(32768);
+    Wire.attach(chip, 0x50);
+    EZI2CStorage storage(32768, 64, 0x50);
+    EZPROM external(storage);
+    external.reset();
+    CHECK(savePattern(external, 1, 1000, 1));
+    CHECK(hasPattern(external, 1, 1000, 1));
+}
+
+TEST(i2cWritesEachPageOnce) {
+    static EEPROMSim chip(32768, EEPROMCostModel::I2C_24LC256);
+    chip.resize(32768);
+    Wire.attach(chip, 0x50);
+    EZI2CStorage storage(32768, 64, 0x50);
+    uint8_t data[1024];
+    fillPattern(data, sizeof (data), 2);
+    chip.resetCounters();
+    CHECK(storage.update(0, data, sizeof (data)) == sizeof (data));
+    //the Wire buffer holds a whole page and its address
+    CHECK(chip.counters().writeCycles == sizeof (data) / 64);
+    uint8_t loaded[1024];
+    storage.read(0, loaded, sizeof (loaded));
+    CHECK(memcmp(data, loaded, sizeof (data)) == 0);
+}
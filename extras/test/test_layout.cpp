@@ -0,0 +1,78 @@
+// Fixed layouts computed at compile time, see EZLayout.
+
+#include "test.h"
+#include <EZLayout.h>
+
+namespace {
+
+struct Settings {
+    uint16_t port;
+    uint8_t mode;
+};
+
+typedef EZLayout<16,
+        EZSlot<5, Settings>,
+        EZSlot<1, char, 32>,
+        EZSlot<9, uint32_t>,
+        EZSlot<2, uint8_t, 3> > Layout;
+
+static_assert(Layout::start == 16, "start");
+static_assert(Layout::size == sizeof (Settings) + 32 + 4 + 3, "size");
+static_assert(Layout::end == Layout::start + Layout::size, "end");
+static_assert(Layout::address<5>() == 16, "the first slot starts the layout");
+static_assert(Layout::address<1>() == 16 + sizeof (Settings), "slots follow in order");
+static_assert(Layout::address<9>() == 16 + sizeof (Settings) + 32, "arrays take all elements");
+static_assert(Layout::address<2>() == Layout::end - 3, "the last slot ends the layout");
+static_assert(Layout::sizeOf<1>() == 32 && Layout::sizeOf<2>() == 3, "sizes");
+
+}
+
+TEST(layoutRoundTripsAtItsAddresses) {
+    Settings settings = {8080, 3};
+    Layout::save<5>(settings);
+    char name[32] = "front door";
+    Layout::save<1>(*name);
+    uint32_t counter = 0x12345678;
+    Layout::save<9>(counter);
+
+    Settings loadedSettings = {};
+    Layout::load<5>(loadedSettings);
+    CHECK(loadedSettings.port == 8080 && loadedSettings.mode == 3);
+    char loadedName[32];
+    Layout::load<1>(*loadedName);
+    CHECK(strcmp(loadedName, name) == 0);
+    uint32_t loadedCounter = 0;
+    Layout::load<9>(loadedCounter);
+    CHECK(loadedCounter == counter);
+
+    //the bytes are where the layout says, and nothing else is written
+    uint32_t stored = 0;
+    EEPROM.get(Layout::address<9>(), stored);
+    CHECK(stored == counter);
+    CHECK(EEPROM.read(Layout::start - 1) == 0xFF);
+    CHECK(EEPROM.read(Layout::end - 1) == 0xFF);
+}
+
+TEST(layoutWritesOnlyChangedBytes) {
+    uint32_t counter = 0x01020304;
+    Layout::save<9>(counter);
+    EEPROM.resetCounters();
+    counter = 0x01020305;
+    Layout::save<9>(counter);
+    CHECK(EEPROM.counters().writes == 1);
+}
+
+TEST(layoutLeavesRestToEZPROM) {
+    EZPROM ezprom;
+    ezprom.setRegion(Layout::end);
+    ezprom.reset();
+    uint8_t flags[3] = {1, 2, 3};
+    Layout::save<2>(*flags);
+    while (savePattern(ezprom, ezprom.getObjectAmount(), 100, ezprom.getObjectAmount())) {
+    }
+    CHECK(ezprom.getObjectAmount() > 0);
+    uint8_t loaded[3];
+    Layout::load<2>(*loaded);
+    CHECK(memcmp(loaded, flags, 3) == 0);
+    CHECK(hasPattern(ezprom, 0, 100, 0));
+}
@@ -0,0 +1,196 @@
+// The wear-leveled log, see EZLog.
+
+#include "test.h"
+#include <EZLog.h>
+
+namespace {
+
+// true if the object with @id holds @size bytes of the pattern of @seed
+bool logHasPattern(EZLog & log, uint8_t id, uint16_t size, uint8_t seed) {
+    uint8_t expected[size];
+    uint8_t loaded[size];
+    fillPattern(expected, size, seed);
+    return log.getSize(id) == size && log.load(id, *loaded)
+            && memcmp(expected, loaded, size) == 0;
+}
+
+// saves @size bytes of the pattern of @seed under @id
+bool logSavePattern(EZLog & log, uint8_t id, uint16_t size, uint8_t seed) {
+    uint8_t data[size];
+    fillPattern(data, size, seed);
+    return log.save(id, *data, size);
+}
+
+// a RAM backend that loses power after a given amount of written bytes
+class CutStorage : public EZStorage {
+public:
+    uint8_t data[256];
+    uint16_t budget = 0xFFFF;
+
+    uint16_t length() {
+        return sizeof (data);
+    }
+
+    void read(uint16_t address, uint8_t* ram, uint16_t size) {
+        memcpy(ram, data + address, size);
+    }
+
+    uint16_t update(uint16_t address, const uint8_t* ram, uint16_t size) {
+        uint16_t written = 0;
+        for (uint16_t i = 0; i < size && budget > 0; i++) {
+            if (data[address + i] != ram[i]) {
+                data[address + i] = ram[i];
+                budget--;
+                written++;
+            }
+        }
+        return written;
+    }
+};
+
+}
+
+TEST(logRoundTripsAcrossRotations) {
+    EZLog log(0, 256, 4);
+    CHECK(log.setup());
+    for (uint8_t round = 0; round < 100; round++) {
+        CHECK(logSavePattern(log, round % 5, 4 + round % 7, round));
+    }
+    CHECK(log.getObjectAmount() == 5);
+    for (uint8_t round = 95; round < 100; round++) {
+        CHECK(logHasPattern(log, round % 5, 4 + round % 7, round));
+    }
+    CHECK(log.remove(2));
+    CHECK(!log.exists(2));
+    CHECK(log.getObjectAmount() == 4);
+}
+
+TEST(logSurvivesRemount) {
+    {
+        EZLog log(16, 240, 3);
+        CHECK(log.setup());
+        for (uint8_t round = 0; round < 40; round++) {
+            CHECK(logSavePattern(log, round % 3, 10, round));
+        }
+        CHECK(log.remove(1));
+    }
+    EZLog mounted(16, 240, 3);
+    CHECK(!mounted.setup());
+    CHECK(mounted.getObjectAmount() == 2);
+    CHECK(!mounted.exists(1));
+    CHECK(logHasPattern(mounted, 0, 10, 39));
+    CHECK(logHasPattern(mounted, 2, 10, 38));
+}
+
+TEST(logRejectsSaveThatDoesNotFitWithoutWriting) {
+    //blocks of 64 bytes hold one 40 byte record each, so two records never
+    //share the two blocks that are not kept free, although their total fits
+    EZLog log(0, 192, 3);
+    CHECK(log.setup());
+    CHECK(logSavePattern(log, 1, 35, 1));
+    CHECK(logSavePattern(log, 2, 35, 2));
+    EEPROM.resetCounters();
+    CHECK(!logSavePattern(log, 3, 35, 3));
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(logHasPattern(log, 1, 35, 1));
+    CHECK(logHasPattern(log, 2, 35, 2));
+
+    EZLog mounted(0, 192, 3);
+    CHECK(!mounted.setup());
+    CHECK(mounted.getObjectAmount() == 2);
+    CHECK(logHasPattern(mounted, 1, 35, 1));
+    CHECK(logHasPattern(mounted, 2, 35, 2));
+}
+
+TEST(logSavesAgainUpToItsCapacity) {
+    const uint8_t blocks[] = {2, 3, 5};
+    for (uint8_t i = 0; i < 3; i++) {
+        EEPROM.fill(0xFF);
+        EZLog log(0, 200, blocks[i]);
+        CHECK(log.setup());
+        uint16_t capacity = log.getCapacity(12);
+        CHECK(capacity > 0);
+        for (uint8_t id = 0; id < capacity; id++) {
+            CHECK(logSavePattern(log, id, 12, id));
+        }
+        //every object can be saved again as often as needed
+        for (uint8_t round = 0; round < 50; round++) {
+            CHECK(logSavePattern(log, round % capacity, 12, round + 100));
+        }
+        for (uint8_t id = 0; id < capacity; id++) {
+            uint8_t last = 49 - (49 - id) % capacity;
+            CHECK(logHasPattern(log, id, 12, last + 100));
+        }
+    }
+    EZLog log(0, 200, 4);
+    CHECK(log.getCapacity(log.getMaxObjectSize() + 1) == 0);
+}
+
+TEST(logWithTwoBlocksCopiesAllObjects) {
+    //the live objects and the new version must share one block of 60 bytes
+    EZLog log(0, 128, 2);
+    CHECK(log.setup());
+    CHECK(logSavePattern(log, 1, 20, 1));
+    CHECK(logSavePattern(log, 2, 20, 2));
+    EEPROM.resetCounters();
+    CHECK(!logSavePattern(log, 2, 20, 3));
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(logHasPattern(log, 2, 20, 2));
+    CHECK(log.remove(2));
+    for (uint8_t round = 0; round < 30; round++) {
+        CHECK(logSavePattern(log, 2, 10, round));
+    }
+    EZLog mounted(0, 128, 2);
+    CHECK(!mounted.setup());
+    CHECK(logHasPattern(mounted, 1, 20, 1));
+    CHECK(logHasPattern(mounted, 2, 10, 29));
+}
+
+TEST(logKeepsOldOrNewVersionOnPowerCut) {
+    //cut the power after every possible amount of written bytes
+    for (uint16_t budget = 0; budget < 200; budget++) {
+        CutStorage storage;
+        memset(storage.data, 0xFF, sizeof (storage.data));
+        {
+            EZLog log(storage, 0, 256, 4);
+            CHECK(log.setup());
+            for (uint8_t round = 0; round < 12; round++) {
+                CHECK(logSavePattern(log, round % 3, 12, round));
+            }
+            storage.budget = budget;
+            for (uint8_t round = 12; round < 24; round++) {
+                logSavePattern(log, round % 3, 12, round);
+            }
+        }
+        storage.budget = 0xFFFF;
+        EZLog mounted(storage, 0, 256, 4);
+        CHECK(!mounted.setup());
+        CHECK(mounted.getObjectAmount() == 3);
+        for (uint8_t id = 0; id < 3; id++) {
+            uint8_t loaded[12];
+            CHECK(mounted.load(id, *loaded));
+            bool found = false;
+            for (uint8_t round = id; round < 24 && !found; round += 3) {
+                uint8_t expected[12];
+                fillPattern(expected, 12, round);
+                found = memcmp(expected, loaded, 12) == 0;
+            }
+            CHECK(found);
+        }
+        //the log is usable again after the remount
+        CHECK(logSavePattern(mounted, 0, 12, 100));
+        CHECK(logHasPattern(mounted, 0, 12, 100));
+    }
+}
+
+TEST(logSpreadsWearOverTheRegion) {
+    EZLog log(0, 256, 4);
+    CHECK(log.setup());
+    EEPROM.resetCounters();
+    for (uint16_t round = 0; round < 1000; round++) {
+        CHECK(logSavePattern(log, 1, 10, round));
+    }
+    //each save writes 15 bytes into the 4 blocks in turn, so no cell is
+    //written much more often than once per turn of the log
+    CHECK(EEPROM.maxCellWrites() <= 1000 * 15 / (4 * 60) + 4);
+}
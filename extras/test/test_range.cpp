@@ -0,0 +1,91 @@
+// Parts of objects, see EZPROM#loadRange, EZPROM#saveRange and EZPROM#view.
+
+#include "test.h"
+
+TEST(rangeReadsAndWritesOnlyThePart) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 64, 2));
+    uint8_t expected[64];
+    fillPattern(expected, sizeof (expected), 2);
+
+    EEPROM.resetCounters();
+    uint8_t part[8];
+    CHECK(ezprom.loadRange(2, 16, sizeof (part), *part));
+    CHECK(memcmp(part, expected + 16, sizeof (part)) == 0);
+    CHECK(EEPROM.counters().reads < 64);
+
+    uint8_t data[8];
+    fillPattern(data, sizeof (data), 9);
+    CHECK(ezprom.saveRange(2, 56, *data, sizeof (data)));
+    memcpy(expected + 56, data, sizeof (data));
+    uint8_t loaded[64];
+    CHECK(ezprom.load(2, *loaded));
+    CHECK(memcmp(loaded, expected, sizeof (expected)) == 0);
+    CHECK(ezprom.verify(2));
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+}
+
+TEST(rangeRejectsBytesPastTheObject) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 10, 2));
+    uint8_t data[8];
+    fillPattern(data, sizeof (data), 3);
+    //the range may end at the end of the object, but not past it
+    CHECK(ezprom.loadRange(1, 2, 8, *data));
+    CHECK(ezprom.loadRange(1, 10, 0, *data));
+    CHECK(!ezprom.loadRange(1, 3, 8, *data));
+    CHECK(!ezprom.loadRange(1, 11, 0, *data));
+    CHECK(!ezprom.loadRange(1, 0xFFFF, 2, *data));
+    CHECK(!ezprom.loadRange(3, 0, 1, *data));
+
+    EEPROM.resetCounters();
+    CHECK(!ezprom.saveRange(1, 3, *data, 8));
+    CHECK(!ezprom.saveRange(1, 8, *data, 0xFFFF));
+    CHECK(!ezprom.saveRange(3, 0, *data, 1));
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 2, 10, 2));
+}
+
+TEST(viewAccessesElements) {
+    EZPROM ezprom;
+    ezprom.reset();
+    uint16_t counts[5] = {10, 20, 30, 40, 50};
+    CHECK(ezprom.save(1, *counts, 5));
+    EZPROM::View<uint16_t> view = ezprom.view<uint16_t>(1);
+    CHECK(view.size() == 5);
+    CHECK(view[3] == 40);
+    view[3] = view[3] + 1;
+    view[0] = view[4];
+    uint16_t loaded[5];
+    CHECK(ezprom.load(1, *loaded));
+    CHECK(loaded[0] == 50 && loaded[3] == 41 && loaded[4] == 50);
+    CHECK(ezprom.verify(1));
+}
+
+TEST(viewIgnoresElementsPastTheEnd) {
+    EZPROM ezprom;
+    ezprom.reset();
+    uint16_t counts[3] = {1, 2, 3};
+    CHECK(ezprom.save(1, *counts, 3));
+    CHECK(savePattern(ezprom, 2, 10, 2));
+    EZPROM::View<uint16_t> view = ezprom.view<uint16_t>(1);
+    CHECK(view[3] == 0);
+    EEPROM.resetCounters();
+    view[3] = 7;
+    view[1000] = 7;
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(hasPattern(ezprom, 2, 10, 2));
+
+    //an object whose size is not a multiple of the element has no partial element
+    CHECK(savePattern(ezprom, 3, 5, 3));
+    EZPROM::View<uint16_t> odd = ezprom.view<uint16_t>(3);
+    CHECK(odd.size() == 2);
+    CHECK(odd[2] == 0);
+    CHECK(ezprom.view<uint16_t>(4).size() == 0);
+    CHECK(ezprom.view<uint16_t>(4)[0] == 0);
+}
@@ -0,0 +1,117 @@
+// Objects that change size, see EZPROM#save and EZPROM#append.
+
+#include "test.h"
+
+namespace {
+
+// true if the object with @id holds @head bytes of the pattern of @headSeed
+// followed by @tail bytes of the pattern of @tailSeed
+bool hasAppended(EZPROM & ezprom, uint8_t id, uint16_t head, uint8_t headSeed, uint16_t tail, uint8_t tailSeed) {
+    uint8_t expected[head + tail];
+    uint8_t loaded[head + tail];
+    fillPattern(expected, head, headSeed);
+    fillPattern(expected + head, tail, tailSeed);
+    return ezprom.getObjectData(id).size == head + tail && ezprom.load(id, *loaded)
+            && memcmp(expected, loaded, head + tail) == 0 && ezprom.verify(id);
+}
+
+// appends @size bytes of the pattern of @seed to the object with @id
+bool appendPattern(EZPROM & ezprom, uint8_t id, uint16_t size, uint8_t seed) {
+    uint8_t data[size];
+    fillPattern(data, size, seed);
+    return ezprom.append(id, *data, size);
+}
+
+}
+
+TEST(resizeGrowsInPlace) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(savePattern(ezprom, 3, 30, 3));
+    CHECK(savePattern(ezprom, 2, 45, 4));
+    CHECK(ezprom.getAddress(2) == 10);
+    CHECK(ezprom.getAddress(3) == 55);
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 2, 45, 4));
+    CHECK(hasPattern(ezprom, 3, 30, 3));
+}
+
+TEST(resizeShrinksInPlace) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(savePattern(ezprom, 3, 30, 3));
+    CHECK(savePattern(ezprom, 2, 5, 4));
+    CHECK(ezprom.getAddress(2) == 10);
+    CHECK(ezprom.getAddress(3) == 15);
+    CHECK(hasPattern(ezprom, 2, 5, 4));
+    CHECK(hasPattern(ezprom, 3, 30, 3));
+
+    EZPROM mounted;
+    CHECK(hasPattern(mounted, 1, 10, 1));
+    CHECK(hasPattern(mounted, 2, 5, 4));
+    CHECK(hasPattern(mounted, 3, 30, 3));
+}
+
+TEST(resizeFailsWithoutSpace) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(!savePattern(ezprom, 1, EZPROM_SIM_SIZE, 3));
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 2, 20, 2));
+}
+
+TEST(appendGrowsObject) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(appendPattern(ezprom, 1, 6, 9));
+    CHECK(ezprom.getAddress(1) == 0);
+    CHECK(ezprom.getAddress(2) == 16);
+    CHECK(hasAppended(ezprom, 1, 10, 1, 6, 9));
+    CHECK(hasPattern(ezprom, 2, 20, 2));
+
+    //the last object grows where it is
+    CHECK(appendPattern(ezprom, 2, 4, 8));
+    CHECK(ezprom.getAddress(2) == 16);
+    CHECK(hasAppended(ezprom, 2, 20, 2, 4, 8));
+
+    EZPROM mounted;
+    CHECK(hasAppended(mounted, 1, 10, 1, 6, 9));
+    CHECK(hasAppended(mounted, 2, 20, 2, 4, 8));
+}
+
+TEST(appendToMissingObjectSavesIt) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(appendPattern(ezprom, 7, 12, 7));
+    CHECK(hasPattern(ezprom, 7, 12, 7));
+}
+
+TEST(appendFailsWithoutSpace) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(!appendPattern(ezprom, 1, EZPROM_SIM_SIZE, 2));
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+}
+
+TEST(appendCopiesSmallObjectBehindLargeTail) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    CHECK(savePattern(ezprom, 1, 4, 1));
+    CHECK(savePattern(ezprom, 2, 300, 2));
+    CHECK(appendPattern(ezprom, 1, 4, 3));
+    //copying 4 bytes is cheaper than shifting 300
+    CHECK(ezprom.getAddress(2) == 4);
+    CHECK(ezprom.getAddress(1) == 304);
+    CHECK(hasAppended(ezprom, 1, 4, 1, 4, 3));
+    CHECK(hasPattern(ezprom, 2, 300, 2));
+}
@@ -0,0 +1,55 @@
+// The ring buffer of records, see EZRing.
+
+#include "test.h"
+#include <EZRing.h>
+
+TEST(ringKeepsTheNewestRecords) {
+    EZPROM ezprom;
+    ezprom.reset();
+    {
+        EZRing<uint32_t> ring(ezprom, 1, 8);
+        CHECK(ring.begin());
+        for (uint32_t i = 0; i < 20; i++) {
+            CHECK(ring.append(i * 1000));
+        }
+    }
+    EZRing<uint32_t> ring(ezprom, 1, 8);
+    CHECK(ring.begin());
+    CHECK(ring.size() == 8);
+    uint32_t record = 0;
+    CHECK(ring.get(0, record) && record == 12000);
+    CHECK(ring.last(record) && record == 19000);
+}
+
+TEST(ringIsStoredUncompressed) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompression(true);
+    {
+        EZRing<uint16_t> ring(ezprom, 1, 32);
+        CHECK(ring.begin());
+        CHECK(ezprom.isCompressionEnabled());
+        CHECK(!(ezprom.getObjectData(1).flags & EZPROM::COMPRESSED_FLAG));
+        CHECK(ring.append(7));
+        CHECK(ring.append(8));
+    }
+    //a restart keeps the records
+    EZRing<uint16_t> ring(ezprom, 1, 32);
+    CHECK(ring.begin());
+    uint16_t record = 0;
+    CHECK(ring.size() == 2);
+    CHECK(ring.last(record) && record == 8);
+}
+
+TEST(ringReplacesCompressedObject) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompression(true);
+    uint8_t zeros[128] = {};
+    CHECK(ezprom.save(1, *zeros, sizeof (zeros)));
+    CHECK(ezprom.getObjectData(1).flags & EZPROM::COMPRESSED_FLAG);
+    EZRing<uint8_t> ring(ezprom, 1, ezprom.getObjectData(1).size / EZRing<uint8_t>::SLOT_SIZE);
+    CHECK(ring.begin());
+    CHECK(!(ezprom.getObjectData(1).flags & EZPROM::COMPRESSED_FLAG));
+    CHECK(ring.append(5));
+}
@@ -0,0 +1,105 @@
+// Serializable classes, see EZPROM#saveSerial and EZPROM#loadSerial.
+
+#include "test.h"
+#include <type_traits>
+
+namespace {
+
+// implements only the byte stream versions, see EZPROM::BufferSerializable
+class Pair : public EZPROM::BufferSerializable {
+public:
+    uint16_t first = 0;
+    uint32_t second = 0;
+
+    void serialize(uint8_t * stream, uint16_t & index) {
+        putObject(first, stream, index);
+        putObject(second, stream, index);
+    }
+
+    void deserialize(uint8_t * stream, uint16_t & index) {
+        getObject(first, stream, index);
+        getObject(second, stream, index);
+    }
+
+    uint16_t size() {
+        return sizeof (first) + sizeof (second);
+    }
+};
+
+// streams its bytes and nests a Pair
+class Record : public EZPROM::Serializable {
+public:
+    uint8_t data[100];
+    Pair pair;
+
+    void serialize(EZPROM::Writer & writer) {
+        writer.write(data, sizeof (data));
+        writer.putSerial(pair);
+    }
+
+    void deserialize(EZPROM::Reader & reader) {
+        reader.read(data, sizeof (data));
+        reader.getSerial(pair);
+    }
+
+    uint16_t size() {
+        return sizeof (data) + pair.size();
+    }
+};
+
+// implements only the byte stream versions but derives from Serializable
+class Legacy : public EZPROM::Serializable {
+public:
+
+    void serialize(uint8_t *, uint16_t &) {
+    }
+
+    void deserialize(uint8_t *, uint16_t &) {
+    }
+};
+
+}
+
+static_assert(std::is_abstract<Legacy>::value, "a Serializable must implement the stream versions");
+
+TEST(bufferSerializableRoundTrip) {
+    EZPROM ezprom;
+    ezprom.reset();
+    Pair saved;
+    saved.first = 0x1234;
+    saved.second = 0xDEADBEEF;
+    CHECK(ezprom.saveSerial(1, &saved));
+    CHECK(ezprom.getObjectData(1).size == saved.size());
+    CHECK(ezprom.verify(1));
+    Pair loaded;
+    CHECK(ezprom.loadSerial(1, &loaded));
+    CHECK(loaded.first == 0x1234 && loaded.second == 0xDEADBEEF);
+}
+
+TEST(bufferSerializableNestsInStream) {
+    EZPROM ezprom;
+    ezprom.reset();
+    Record saved;
+    fillPattern(saved.data, sizeof (saved.data), 3);
+    saved.pair.first = 7;
+    saved.pair.second = 70000;
+    CHECK(ezprom.saveSerial(1, &saved));
+    CHECK(ezprom.getObjectData(1).size == saved.size());
+    Record loaded;
+    CHECK(ezprom.loadSerial(1, &loaded));
+    CHECK(memcmp(saved.data, loaded.data, sizeof (saved.data)) == 0);
+    CHECK(loaded.pair.first == 7 && loaded.pair.second == 70000);
+}
+
+TEST(bufferSerializableCompressed) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompression(true);
+    Pair saved;
+    saved.second = 42;
+    CHECK(ezprom.saveSerial(1, &saved));
+    Pair loaded;
+    loaded.first = 1;
+    CHECK(ezprom.loadSerial(1, &loaded));
+    CHECK(loaded.first == 0 && loaded.second == 42);
+}
@@ -0,0 +1,73 @@
+// The simulated EEPROM and its cost model, see EEPROMSim.
+
+#include "test.h"
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace {
+
+// true if @access aborts the process, run in a child so the tests go on
+bool aborts(void (*access)()) {
+    pid_t child = fork();
+    if (child == 0) {
+        freopen("/dev/null", "w", stderr);
+        access();
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(child, &status, 0);
+    return WIFSIGNALED(status) && WTERMSIG(status) == SIGABRT;
+}
+
+void readPastTheEnd() {
+    EEPROM.read(EZPROM_SIM_SIZE);
+}
+
+void writeBlockPastTheEnd() {
+    uint8_t data[4] = {};
+    EEPROM.writePage(EZPROM_SIM_SIZE - 2, data, sizeof (data));
+}
+
+}
+
+TEST(simCountsUpdates) {
+    CHECK(EEPROM.read(10) == 0xFF);
+    CHECK(EEPROM.update(10, 0x12));
+    CHECK(!EEPROM.update(10, 0x12));
+    const EEPROMSim::Counters & counters = EEPROM.counters();
+    CHECK(counters.reads == 3);
+    CHECK(counters.writes == 1);
+    CHECK(counters.skippedUpdates == 1);
+    CHECK(counters.writeCycles == 1);
+    CHECK(EEPROM.cellWrites(10) == 1);
+    //3 reads of 500 ns and one write cycle of 3.3 ms
+    CHECK(counters.modeledMicros == 3301);
+}
+
+TEST(simPaysOneCyclePerPage) {
+    EEPROM.setCostModel(EEPROMCostModel::I2C_24LC256);
+    uint8_t data[100] = {};
+    //bytes 60 to 159 touch the pages at 0, 64 and 128
+    EEPROM.writePage(60, data, sizeof (data));
+    CHECK(EEPROM.counters().writeCycles == 3);
+    CHECK(EEPROM.counters().writes == 100);
+    //the cycle is paid even if no byte changes
+    EEPROM.writePage(60, data, 4);
+    CHECK(EEPROM.counters().writeCycles == 4);
+    CHECK(EEPROM.counters().writes == 100);
+    CHECK(EEPROM.maxCellWrites() == 1);
+}
+
+TEST(simResizeErasesAndResetsCounters) {
+    EEPROM.write(3, 0);
+    EEPROM.resize(64);
+    CHECK(EEPROM.length() == 64);
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(EEPROM.cellWrites(3) == 0);
+    CHECK(EEPROM.read(3) == 0xFF);
+}
+
+TEST(simAbortsOutOfRange) {
+    CHECK(aborts(readPastTheEnd));
+    CHECK(aborts(writeBlockPastTheEnd));
+}
@@ -0,0 +1,54 @@
+// The counters of what EZPROM did to the storage, see EZPROM#getStats.
+
+#include "test.h"
+
+#if EZPROM_STATS
+
+TEST(statsMatchTheDevice) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    ezprom.resetStats();
+    EEPROM.resetCounters();
+
+    //a save of which only some bytes change, a load, a remove that moves an
+    //object and a save that changes nothing
+    uint8_t data[20];
+    fillPattern(data, 20, 2);
+    data[3] ^= 0xFF;
+    CHECK(ezprom.save(2, *data, 20));
+    CHECK(ezprom.load(2, *data));
+    ezprom.remove(1);
+    CHECK(ezprom.save(2, *data, 20));
+
+    EZPROM::Stats stats = ezprom.getStats();
+    const EEPROMSim::Counters & device = EEPROM.counters();
+    CHECK(stats.writes == device.writes);
+    CHECK(stats.writes > 0);
+    CHECK(stats.skippedWrites > 0);
+    CHECK(stats.compactionBytes == 20);
+    //every updated byte is read first to compare it
+    CHECK(stats.reads + stats.writes + stats.skippedWrites == device.reads);
+}
+
+TEST(statsTimeTheCalls) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.resetStats();
+    EEPROM.resetCounters();
+    CHECK(savePattern(ezprom, 1, 30, 1));
+    //the simulated clock only advances with the device
+    EZPROM::Stats stats = ezprom.getStats();
+    CHECK(stats.lastMicros == EEPROM.counters().modeledMicros);
+    CHECK(stats.maxMicros == stats.lastMicros);
+
+    EEPROM.resetCounters();
+    uint8_t data[30];
+    CHECK(ezprom.load(1, *data));
+    stats = ezprom.getStats();
+    CHECK(stats.lastMicros == EEPROM.counters().modeledMicros);
+    CHECK(stats.lastMicros < stats.maxMicros);
+}
+
+#endif
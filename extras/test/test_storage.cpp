@@ -0,0 +1,86 @@
+// The storage backends, see EZStorage, and objects that a corrupt directory
+// places outside of them.
+
+#include "test.h"
+
+TEST(ramStorageStaysInsideBuffer) {
+    uint8_t buffer[24];
+    memset(buffer, 0xAA, sizeof (buffer));
+    //the last 8 bytes are not part of the storage
+    EZRAMStorage storage(buffer, 16);
+    uint8_t data[8];
+    fillPattern(data, sizeof (data), 1);
+    CHECK(storage.update(12, data, sizeof (data)) == 4);
+    CHECK(memcmp(buffer + 12, data, 4) == 0);
+    CHECK(buffer[16] == 0xAA);
+    CHECK(storage.update(30, data, sizeof (data)) == 0);
+
+    uint8_t loaded[8];
+    storage.read(12, loaded, sizeof (loaded));
+    CHECK(memcmp(loaded, data, 4) == 0);
+    CHECK(loaded[4] == 0xFF && loaded[7] == 0xFF);
+    storage.read(40, loaded, sizeof (loaded));
+    CHECK(loaded[0] == 0xFF && loaded[7] == 0xFF);
+}
+
+TEST(fileStorageStaysInsideImage) {
+    const char * path = "storage_test.img";
+    remove(path);
+    {
+        EZFileStorage storage(path, 64);
+        CHECK(storage.begin());
+        uint8_t data[8];
+        fillPattern(data, sizeof (data), 2);
+        CHECK(storage.update(60, data, sizeof (data)) == 4);
+        CHECK(storage.update(100, data, sizeof (data)) == 0);
+        uint8_t loaded[8];
+        storage.read(60, loaded, sizeof (loaded));
+        CHECK(memcmp(loaded, data, 4) == 0);
+        CHECK(loaded[4] == 0xFF && loaded[7] == 0xFF);
+
+        //the image keeps its length
+        EZPROM ezprom(storage);
+        ezprom.reset();
+        CHECK(savePattern(ezprom, 1, 20, 1));
+        CHECK(hasPattern(ezprom, 1, 20, 1));
+    }
+    FILE * file = fopen(path, "rb");
+    CHECK(file != NULL);
+    fseek(file, 0, SEEK_END);
+    long length = ftell(file);
+    fclose(file);
+    remove(path);
+    CHECK(length == 64);
+
+    EZFileStorage reopened(path, 64);
+    CHECK(reopened.begin());
+    uint8_t erased[4];
+    reopened.read(0, erased, sizeof (erased));
+    reopened.end();
+    remove(path);
+    CHECK(erased[0] == 0xFF && erased[3] == 0xFF);
+}
+
+TEST(objectsOutsideRegionAreNotLoaded) {
+    //a directory of a larger device describes an object of 900 bytes, which
+    //does not fit in the smaller one it is copied to
+    static uint8_t large[1024];
+    memset(large, 0xFF, sizeof (large));
+    EZRAMStorage largeStorage(large, sizeof (large));
+    EZPROM source(largeStorage);
+    source.reset();
+    CHECK(savePattern(source, 1, 900, 1));
+    uint8_t small[128];
+    memset(small, 0xFF, sizeof (small));
+    memcpy(small + 96, large + 1024 - 32, 32);
+    EZRAMStorage smallStorage(small, sizeof (small));
+
+    EZPROM ezprom(smallStorage);
+    CHECK(ezprom.getObjectAmount() == 1);
+    static uint8_t loaded[900];
+    CHECK(!ezprom.load(1, *loaded));
+    CHECK(!ezprom.loadRange(1, 0, 4, *loaded));
+    CHECK(!ezprom.exists(1));
+    CHECK(ezprom.enableCache());
+    CHECK(!ezprom.load(1, *loaded));
+}
@@ -0,0 +1,214 @@
+// Incremental defragmentation, see EZPROM#tick.
+
+#include "test.h"
+
+namespace {
+
+const uint16_t LENGTH = 1024;
+
+// the objects the tests start from, ids 0 to 9; the odd ones are removed
+const uint8_t AMOUNT = 10;
+
+uint16_t getSize(uint8_t id) {
+    return 11 + id * 9;
+}
+
+/**
+ * A device that loses power after a number of bytes were written to it.
+ * Bytes written from @directoryStart on are not counted and never lost,
+ * because a reset while the directory is written is not survived, see
+ * EZPROM#tick.
+ */
+class PowerLossStorage : public EZStorage {
+public:
+    uint8_t memory[LENGTH];
+    // the bytes written before power is lost, -1 to never lose it
+    int32_t budget = -1;
+    bool lost = false;
+    uint16_t directoryStart = LENGTH - 128;
+
+    uint16_t length() {
+        return LENGTH;
+    }
+
+    void read(uint16_t address, uint8_t * ram, uint16_t size) {
+        memcpy(ram, memory + address, size);
+    }
+
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size) {
+        uint16_t written = 0;
+        for (uint16_t i = 0; i < size; i++) {
+            if (memory[address + i] == ram[i] || lost) {
+                continue;
+            }
+            if (budget >= 0 && address + i < directoryStart) {
+                if (budget == 0) {
+                    lost = true;
+                    continue;
+                }
+                budget--;
+            }
+            memory[address + i] = ram[i];
+            written++;
+        }
+        return written;
+    }
+};
+
+void saveWithHoles(EZPROM & ezprom) {
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    for (uint8_t id = 0; id < AMOUNT; id++) {
+        savePattern(ezprom, id, getSize(id), id);
+    }
+    for (uint8_t id = 1; id < AMOUNT; id += 2) {
+        ezprom.remove(id);
+    }
+}
+
+// true if the even objects are intact and the odd ones gone
+bool isIntact(EZPROM & ezprom) {
+    for (uint8_t id = 0; id < AMOUNT; id++) {
+        if (ezprom.exists(id) != (id % 2 == 0)
+                || (id % 2 == 0 && !hasPattern(ezprom, id, getSize(id), id))) {
+            return false;
+        }
+    }
+    return ezprom.getObjectAmount() == AMOUNT / 2;
+}
+
+// true if the even objects follow each other from address 0
+bool isCompact(EZPROM & ezprom) {
+    uint16_t address = 0;
+    for (uint8_t id = 0; id < AMOUNT; id += 2) {
+        if (ezprom.getAddress(id) != address) {
+            return false;
+        }
+        address += getSize(id);
+    }
+    return true;
+}
+
+}
+
+TEST(tickMovesAtMostMaxBytes) {
+    EZPROM ezprom;
+    saveWithHoles(ezprom);
+    uint16_t calls = 0;
+    bool more = true;
+    while (more) {
+        CHECK(++calls < 1000);
+#if EZPROM_STATS
+        ezprom.resetStats();
+#endif
+        more = ezprom.tick(16);
+#if EZPROM_STATS
+        CHECK(ezprom.getStats().compactionBytes <= 16);
+#endif
+    }
+    //the objects hold 11 + 29 + 47 + 65 + 83 bytes, some of which take
+    //several calls
+    CHECK(calls > AMOUNT / 2);
+    CHECK(isIntact(ezprom));
+    CHECK(isCompact(ezprom));
+    CHECK(!ezprom.tick(16));
+}
+
+TEST(callsBetweenTicksFinishTheMove) {
+    EZPROM ezprom;
+    saveWithHoles(ezprom);
+    while (ezprom.tick(3)) {
+        CHECK(isIntact(ezprom));
+    }
+    CHECK(isCompact(ezprom));
+}
+
+TEST(tickEndsLikeCompact) {
+    EZPROM ticked;
+    saveWithHoles(ticked);
+    while (ticked.tick(5)) {
+    }
+    uint8_t image[EZPROM_SIM_SIZE];
+    EEPROM.readBlock(0, image, sizeof (image));
+
+    EZPROM compacted;
+    saveWithHoles(compacted);
+    compacted.compact();
+    CHECK(isCompact(compacted));
+    for (uint16_t address = 0; address < 11 + 29 + 47 + 65 + 83; address++) {
+        CHECK(EEPROM.read(address) == image[address]);
+    }
+}
+
+TEST(tickWaitsForBatch) {
+    EZPROM ezprom;
+    saveWithHoles(ezprom);
+    EEPROM.resetCounters();
+    CHECK(ezprom.beginBatch());
+    //a loop until tick returns false must end during a batch
+    CHECK(!ezprom.tick(16));
+    CHECK(EEPROM.counters().writes == 0);
+    ezprom.commitBatch();
+    CHECK(ezprom.tick(16));
+    while (ezprom.tick(16)) {
+    }
+    CHECK(isIntact(ezprom));
+    CHECK(isCompact(ezprom));
+}
+
+TEST(tickResumesAfterPowerLoss) {
+    static PowerLossStorage device;
+    memset(device.memory, 0xFF, LENGTH);
+    {
+        EZPROM ezprom(device);
+        saveWithHoles(ezprom);
+        CHECK(isIntact(ezprom));
+    }
+    uint8_t image[LENGTH];
+    memcpy(image, device.memory, LENGTH);
+
+    //lose power after every possible byte of the move, then start again
+    for (int32_t cut = 0;; cut++) {
+        memcpy(device.memory, image, LENGTH);
+        device.budget = cut;
+        device.lost = false;
+        bool finished = false;
+        {
+            EZPROM ezprom(device);
+            ezprom.setCompactOnRemove(false);
+            //vary the slices, so that power is lost in all of them
+            while (!device.lost) {
+                if (!ezprom.tick(1 + cut % 23)) {
+                    finished = true;
+                    break;
+                }
+            }
+        }
+        device.budget = -1;
+        device.lost = false;
+
+        EZPROM restarted(device);
+        restarted.setCompactOnRemove(false);
+        CHECK(isIntact(restarted));
+        uint16_t calls = 0;
+        while (restarted.tick(7)) {
+            CHECK(++calls < 1000);
+        }
+        CHECK(isIntact(restarted));
+        CHECK(isCompact(restarted));
+        if (finished) {
+            break;
+        }
+    }
+}
+
+TEST(erasedDeviceIsNotTakenForJournal) {
+    //an erased amount byte describes more entries than the device holds
+    EEPROM.resize(512);
+    EZPROM ezprom;
+    ezprom.setRegion(16);
+    CHECK(ezprom.setup(77));
+    CHECK(!ezprom.tick(16));
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+}
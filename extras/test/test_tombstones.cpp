@@ -0,0 +1,87 @@
+// Deferred removal and compaction, see EZPROM#setCompactOnRemove and
+// EZPROM#compact.
+
+#include "test.h"
+
+TEST(removeShiftsObjectsByDefault) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(savePattern(ezprom, 3, 30, 3));
+    uint16_t third = ezprom.getAddress(3);
+    ezprom.remove(2);
+    CHECK(!ezprom.exists(2));
+    CHECK(ezprom.getAddress(3) == third - 20);
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 3, 30, 3));
+}
+
+TEST(removeLeavesTombstoneUntilCompact) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    CHECK(savePattern(ezprom, 3, 30, 3));
+    uint16_t third = ezprom.getAddress(3);
+
+    //only the flags of the directory entry change
+    EEPROM.resetCounters();
+    ezprom.remove(2);
+    CHECK(EEPROM.counters().writes == 1);
+    CHECK(!ezprom.exists(2));
+    CHECK(ezprom.getObjectAmount() == 2);
+    CHECK(ezprom.getAddress(3) == third);
+
+    ezprom.compact();
+    CHECK(ezprom.getAddress(3) == third - 20);
+    CHECK(hasPattern(ezprom, 1, 10, 1));
+    CHECK(hasPattern(ezprom, 3, 30, 3));
+
+    //a tombstone survives a reset
+    ezprom.remove(1);
+    EZPROM restarted;
+    CHECK(!restarted.exists(1));
+    CHECK(restarted.getAddress(3) == third - 20);
+    restarted.compact();
+    CHECK(restarted.getAddress(3) == 0);
+    CHECK(hasPattern(restarted, 3, 30, 3));
+}
+
+TEST(removingTheLastObjectLeavesNoTombstone) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    CHECK(savePattern(ezprom, 1, 10, 1));
+    CHECK(savePattern(ezprom, 2, 20, 2));
+    ezprom.remove(2);
+    CHECK(savePattern(ezprom, 3, 5, 3));
+    CHECK(ezprom.getAddress(3) == 10);
+}
+
+TEST(saveCompactsWhenOnlyTombstonesLeaveRoom) {
+    EZPROM ezprom;
+    ezprom.reset();
+    ezprom.setCompactOnRemove(false);
+    uint8_t amount = 0;
+    while (savePattern(ezprom, amount, 100, amount)) {
+        amount++;
+    }
+    CHECK(amount >= 8);
+    for (uint8_t id = 0; id < amount; id += 2) {
+        ezprom.remove(id);
+    }
+    //larger than any single hole, but fits once they are reclaimed
+    CHECK(savePattern(ezprom, 200, 250, 200));
+    CHECK(hasPattern(ezprom, 200, 250, 200));
+    for (uint8_t id = 0; id < amount; id++) {
+        CHECK(ezprom.exists(id) == (id % 2 == 1));
+        if (id % 2 == 1) {
+            CHECK(hasPattern(ezprom, id, 100, id));
+        }
+    }
+    //the objects were shifted down in a single pass
+    CHECK(ezprom.getAddress(1) == 0);
+    CHECK(ezprom.getAddress(3) == 100);
+}
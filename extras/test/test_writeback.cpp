@@ -0,0 +1,99 @@
+// The write-back cache, see EZPROM#enableWriteBack.
+
+#include "test.h"
+
+TEST(writeBackKeepsSavesInRam) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 8, 1));
+    CHECK(ezprom.enableWriteBack(4, 64));
+    EEPROM.resetCounters();
+    for (uint8_t round = 2; round < 20; round++) {
+        CHECK(savePattern(ezprom, 1, 8, round));
+    }
+    CHECK(EEPROM.counters().writes == 0);
+    uint8_t expected[8];
+    uint8_t loaded[8];
+    fillPattern(expected, 8, 19);
+    CHECK(ezprom.load(1, *loaded));
+    CHECK(memcmp(loaded, expected, 8) == 0);
+
+    //a reset now would lose the value
+    {
+        EZPROM other;
+        CHECK(hasPattern(other, 1, 8, 1));
+    }
+    CHECK(ezprom.flush());
+    EZPROM other;
+    CHECK(hasPattern(other, 1, 8, 19));
+}
+
+TEST(writeBackWritesNewObjectsAndNewSizes) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(ezprom.enableWriteBack(4, 64));
+    CHECK(savePattern(ezprom, 1, 8, 1));
+    CHECK(savePattern(ezprom, 1, 12, 2));
+    EZPROM other;
+    CHECK(hasPattern(other, 1, 12, 2));
+}
+
+TEST(writeBackFlushesExpiredValues) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 8, 1));
+    CHECK(ezprom.enableWriteBack(4, 64));
+    ezprom.setFlushDeadline(100);
+    CHECK(savePattern(ezprom, 1, 8, 2));
+    delay(50);
+    ezprom.flushExpired();
+    {
+        EZPROM other;
+        CHECK(hasPattern(other, 1, 8, 1));
+    }
+    delay(60);
+    ezprom.flushExpired();
+    EZPROM other;
+    CHECK(hasPattern(other, 1, 8, 2));
+}
+
+TEST(writeBackKeepsWithinBudget) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 6, 1));
+    CHECK(savePattern(ezprom, 2, 6, 2));
+    CHECK(ezprom.enableWriteBack(4, 64));
+    ezprom.setFlushBudget(8);
+    CHECK(savePattern(ezprom, 1, 6, 3));
+    CHECK(savePattern(ezprom, 2, 6, 4));
+    //12 dirty bytes are over budget, so the least recently used is written
+    EZPROM other;
+    CHECK(hasPattern(other, 1, 6, 3));
+    CHECK(hasPattern(other, 2, 6, 2));
+}
+
+TEST(writeBackIsFlushedOnDestroy) {
+    {
+        EZPROM ezprom;
+        ezprom.reset();
+        CHECK(savePattern(ezprom, 1, 8, 1));
+        CHECK(ezprom.enableWriteBack(4, 64));
+        CHECK(savePattern(ezprom, 1, 8, 2));
+    }
+    EZPROM other;
+    CHECK(hasPattern(other, 1, 8, 2));
+}
+
+TEST(writeBackIsDroppedByReset) {
+    EZPROM ezprom;
+    ezprom.reset();
+    CHECK(savePattern(ezprom, 1, 8, 1));
+    CHECK(ezprom.enableWriteBack(4, 64));
+    CHECK(savePattern(ezprom, 1, 8, 2));
+    ezprom.reset();
+    CHECK(!ezprom.exists(1));
+    EEPROM.resetCounters();
+    ezprom.disableWriteBack();
+    CHECK(EEPROM.counters().writes == 0);
+    CHECK(!ezprom.exists(1));
+}
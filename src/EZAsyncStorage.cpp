@@ -0,0 +1,206 @@
+#include "EZAsyncStorage.h"
+
+#if defined(__AVR__) && defined(EE_READY_vect)
+#include <avr/interrupt.h>
+#include <util/atomic.h>
+//keeps the interrupt from changing the queue while the block runs
+#define QUEUE_LOCK ATOMIC_BLOCK(ATOMIC_RESTORESTATE)
+#define EZPROM_ASYNC_INTERRUPT
+
+// the instance drained by the EEPROM ready interrupt
+static EZAsyncStorage * interruptStorage = NULL;
+
+ISR(EE_READY_vect) {
+    interruptStorage->onReady();
+}
+#else
+#define QUEUE_LOCK
+#endif
+
+EZAsyncStorage::EZAsyncStorage(EZStorage& target)
+: target(&target), interruptDriven(false) {
+#if defined(EZPROM_ASYNC_INTERRUPT)
+    if (&target == &ezEEPROM) {
+        interruptDriven = true;
+        interruptStorage = this;
+    }
+#endif
+}
+
+uint16_t EZAsyncStorage::length() {
+    return target->length();
+}
+
+void EZAsyncStorage::read(uint16_t address, uint8_t* ram, uint16_t size) {
+    //the interrupt must not start a write cycle while the device is read, but
+    //other interrupts keep running during the wait below
+    stopInterrupt();
+    //waits for a write cycle in progress, so a dequeued byte is read correctly
+    target->read(address, ram, size);
+    QUEUE_LOCK {
+        //the queued bytes are newer than the device
+        for (uint8_t i = 0; i < count; i++) {
+            QueuedByte & queuedByte = queue[(head + i) % EZPROM_ASYNC_QUEUE];
+            if (queuedByte.address >= address && queuedByte.address - address < size) {
+                ram[queuedByte.address - address] = queuedByte.value;
+            }
+        }
+    }
+    //also counts a byte whose write cycle finished during the read, see #onReady
+    startInterrupt();
+}
+
+uint16_t EZAsyncStorage::update(uint16_t address, const uint8_t* ram, uint16_t size) {
+    uint16_t changed = 0;
+    uint8_t current[16];
+    for (uint16_t done = 0; done < size;) {
+        uint16_t chunk = size - done < (uint16_t) sizeof (current) ? size - done : (uint16_t) sizeof (current);
+        read(address + done, current, chunk);
+        for (uint16_t i = 0; i < chunk; i++) {
+            if (current[i] != ram[done + i]) {
+                enqueue(address + done + i, ram[done + i]);
+                changed++;
+            }
+        }
+        done += chunk;
+    }
+    return changed;
+}
+
+uint8_t EZAsyncStorage::getCapabilities() {
+    return target->getCapabilities();
+}
+
+uint16_t EZAsyncStorage::getPageSize() {
+    return target->getPageSize();
+}
+
+void EZAsyncStorage::enqueue(uint16_t address, uint8_t value) {
+    QUEUE_LOCK {
+        for (uint8_t i = 0; i < count; i++) {
+            QueuedByte & queuedByte = queue[(head + i) % EZPROM_ASYNC_QUEUE];
+            if (queuedByte.address == address) {
+                queuedByte.value = value;
+                return;
+            }
+        }
+    }
+    //back-pressure: wait for room
+    while (space() == 0) {
+        if (interruptDriven) {
+            startInterrupt();
+        } else {
+            poll();
+        }
+    }
+    QUEUE_LOCK {
+        QueuedByte & queuedByte = queue[(head + count) % EZPROM_ASYNC_QUEUE];
+        queuedByte.address = address;
+        queuedByte.value = value;
+        count++;
+        queued++;
+    }
+    startInterrupt();
+}
+
+bool EZAsyncStorage::poll() {
+    if (interruptDriven) {
+        return pending() > 0;
+    }
+    if (count == 0) {
+        return false;
+    }
+    //write a run of consecutive addresses at once, so paged devices write it in one cycle
+    uint8_t run[16];
+    uint16_t address = queue[head].address;
+    uint8_t length = 0;
+    while (length < count && length < sizeof (run)) {
+        QueuedByte & queuedByte = queue[(head + length) % EZPROM_ASYNC_QUEUE];
+        if (queuedByte.address != address + length) {
+            break;
+        }
+        run[length++] = queuedByte.value;
+    }
+    target->update(address, run, length);
+    head = (head + length) % EZPROM_ASYNC_QUEUE;
+    count -= length;
+    written += length;
+    return count > 0;
+}
+
+EZAsyncStorage::Ticket EZAsyncStorage::ticket() {
+    Ticket ticket;
+    QUEUE_LOCK {
+        ticket = queued;
+    }
+    return ticket;
+}
+
+bool EZAsyncStorage::isDone(Ticket ticket) {
+    Ticket done;
+    QUEUE_LOCK {
+        done = written;
+    }
+    //the counters may wrap around
+    return (int32_t) (done - ticket) >= 0;
+}
+
+uint8_t EZAsyncStorage::pending() {
+    uint8_t amount;
+    QUEUE_LOCK {
+        amount = count + (inFlight ? 1 : 0);
+    }
+    return amount;
+}
+
+uint8_t EZAsyncStorage::space() {
+    return EZPROM_ASYNC_QUEUE - count;
+}
+
+void EZAsyncStorage::waitAll() {
+    if (interruptDriven) {
+        startInterrupt();
+        while (pending() > 0) {
+        }
+        return;
+    }
+    while (poll()) {
+    }
+}
+
+void EZAsyncStorage::startInterrupt() {
+#if defined(EZPROM_ASYNC_INTERRUPT)
+    if (interruptDriven) {
+        //fires as soon as no write cycle is in progress
+        EECR |= _BV(EERIE);
+    }
+#endif
+}
+
+void EZAsyncStorage::stopInterrupt() {
+#if defined(EZPROM_ASYNC_INTERRUPT)
+    if (interruptDriven) {
+        EECR &= ~_BV(EERIE);
+    }
+#endif
+}
+
+void EZAsyncStorage::onReady() {
+#if defined(EZPROM_ASYNC_INTERRUPT)
+    if (inFlight) {
+        //the write cycle of the last byte just finished
+        inFlight = false;
+        written++;
+    }
+    if (count == 0) {
+        EECR &= ~_BV(EERIE);
+        return;
+    }
+    QueuedByte & queuedByte = queue[head];
+    //no write cycle is in progress, so this returns without waiting
+    eeprom_write_byte((uint8_t *) queuedByte.address, queuedByte.value);
+    head = (head + 1) % EZPROM_ASYNC_QUEUE;
+    count--;
+    inFlight = true;
+#endif
+}
@@ -0,0 +1,134 @@
+#ifndef EZASYNCSTORAGE_H
+#define EZASYNCSTORAGE_H
+
+#include <Arduino.h>
+#include "EZStorage.h"
+
+//the amount of bytes that can wait to be written, each using 3 bytes of RAM
+//on AVR. A save that changes more bytes than fit waits for the queue to drain
+#ifndef EZPROM_ASYNC_QUEUE
+#define EZPROM_ASYNC_QUEUE 32
+#endif
+
+/**
+ * A backend that queues writes in RAM and returns at once, in front of
+ * another backend that does the actual writing. On AVR, a byte of the internal
+ * EEPROM takes about 3.3 ms to write, so a 64 byte save would otherwise stall
+ * loop() for over 200 ms.
+ *
+ * With the internal EEPROM of an AVR, the queue is drained in the background
+ * by the EEPROM ready interrupt, one byte per write cycle. With any other
+ * backend, it is drained by calling #poll regularly, for example from loop().
+ * Reads see the queued bytes, so EZPROM and EZLog work as usual:
+ * EZAsyncStorage async;
+ * EZPROM settings(async);
+ *
+ * settings.save(port_id, port);
+ * EZAsyncStorage::Ticket saved = async.ticket();
+ * ...
+ * if (async.isDone(saved)) {
+ *     //port is in EEPROM
+ * }
+ *
+ * A byte written again before it reached EEPROM is only written once. When
+ * the queue is full, #update waits for it to drain, so nothing is lost; see
+ * #space. Call #waitAll before a reset or before accessing the device by
+ * other means, such as an #EZLayout. Only one EZAsyncStorage may use the
+ * internal EEPROM.
+ */
+class EZAsyncStorage : public EZStorage {
+public:
+
+    /**
+     * Identifies the writes queued so far, see #ticket and #isDone.
+     */
+    typedef uint32_t Ticket;
+
+    /**
+     * @param target the backend the queued bytes are written to, the internal
+     * EEPROM by default; it must outlive the EZAsyncStorage
+     */
+    EZAsyncStorage(EZStorage & target = ezEEPROM);
+
+    uint16_t length();
+    void read(uint16_t address, uint8_t * ram, uint16_t size);
+
+    /**
+     * Queues the bytes of @ram that differ from the device and returns
+     * without waiting for them to be written, unless the queue is full.
+     * @return the amount of bytes that were queued
+     */
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size);
+
+    uint8_t getCapabilities();
+    uint16_t getPageSize();
+
+    /**
+     * Writes the next queued bytes to the backend: a run of consecutive bytes
+     * in one call of its EZStorage#update. Does nothing if the queue is
+     * drained by the EEPROM ready interrupt.
+     * @return true if bytes are still waiting to be written
+     */
+    bool poll();
+
+    /**
+     * @return a ticket for every write queued so far
+     */
+    Ticket ticket();
+
+    /**
+     * @return true if every write queued before @ticket was taken is done
+     */
+    bool isDone(Ticket ticket);
+
+    /**
+     * @return the amount of bytes waiting to be written, including a byte
+     * whose write cycle is in progress
+     */
+    uint8_t pending();
+
+    /**
+     * @return the amount of bytes that can be queued without waiting
+     */
+    uint8_t space();
+
+    /**
+     * Waits until every queued byte is written.
+     */
+    void waitAll();
+
+    // called by the EEPROM ready interrupt, not meant to be called otherwise
+    void onReady();
+
+private:
+
+    // a byte waiting to be written
+    struct QueuedByte {
+        uint16_t address;
+        uint8_t value;
+    };
+
+    EZStorage * target;
+    // true if the queue is drained by the EEPROM ready interrupt
+    bool interruptDriven;
+    QueuedByte queue[EZPROM_ASYNC_QUEUE];
+    // the index of the oldest queued byte
+    volatile uint8_t head = 0;
+    volatile uint8_t count = 0;
+    // true while the interrupt waits for the write cycle of a dequeued byte
+    volatile bool inFlight = false;
+    // the amount of bytes queued and written since the start, see #Ticket
+    volatile Ticket queued = 0;
+    volatile Ticket written = 0;
+
+    // queues @value for @address, replacing a byte already queued for it
+    void enqueue(uint16_t address, uint8_t value);
+
+    // starts draining the queue in the background if it is interrupt driven
+    void startInterrupt();
+
+    // keeps the interrupt from writing the next queued byte, until #startInterrupt
+    void stopInterrupt();
+};
+
+#endif /* EZASYNCSTORAGE_H */
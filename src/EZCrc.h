@@ -0,0 +1,33 @@
+#ifndef EZCRC_H
+#define EZCRC_H
+
+#include <Arduino.h>
+
+/**
+ * Table-driven CRC kernels shared by EZPROM and EZLog. The tables are kept in
+ * PROGMEM on AVR; elsewhere CRC-32 processes four bytes per step (slicing-by-4).
+ *
+ * Every function continues the CRC given in @crc, so a CRC can be computed in
+ * pieces: crc16(b, nb, crc16(a, na)) is the CRC of a followed by b. The
+ * default @crc starts a new CRC.
+ */
+class EZCrc {
+public:
+    /**
+     * CRC-8/SMBUS: polynomial 0x07, initial value 0.
+     */
+    static uint8_t crc8(const uint8_t * data, uint16_t length, uint8_t crc = 0);
+
+    /**
+     * CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF.
+     */
+    static uint16_t crc16(const uint8_t * data, uint16_t length, uint16_t crc = 0xFFFF);
+
+    /**
+     * CRC-32 as used by zlib and Ethernet: reflected polynomial 0xEDB88320,
+     * initial value and final XOR 0xFFFFFFFF.
+     */
+    static uint32_t crc32(const uint8_t * data, uint16_t length, uint32_t crc = 0);
+};
+
+#endif /* EZCRC_H */
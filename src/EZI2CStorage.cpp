@@ -0,0 +1,117 @@
+#include "EZI2CStorage.h"
+
+// the most bytes moved in one Wire transaction: requestFrom takes the amount
+// as a uint8_t, even with a Wire buffer of 256 bytes
+static const uint16_t TRANSFER_LENGTH = EZPROM_I2C_BUFFER < 255 ? EZPROM_I2C_BUFFER : 255;
+
+EZI2CStorage::EZI2CStorage(uint16_t length, uint8_t pageSize, uint8_t deviceAddress, TwoWire& wire)
+: wire(&wire), chipLength(length), pageSize(pageSize), deviceAddress(deviceAddress) {
+}
+
+uint16_t EZI2CStorage::length() {
+    return chipLength;
+}
+
+uint8_t EZI2CStorage::getCapabilities() {
+    return WEARS | PAGED | PERSISTENT;
+}
+
+uint16_t EZI2CStorage::getPageSize() {
+    return pageSize;
+}
+
+uint8_t EZI2CStorage::getAddressBytes() {
+    return chipLength <= 2048 ? 1 : 2;
+}
+
+void EZI2CStorage::beginAccess(uint16_t address) {
+    if (getAddressBytes() == 1) {
+        //the top bits of the address select the 256 byte block
+        wire->beginTransmission((uint8_t) (deviceAddress | ((address >> 8) & 0x07)));
+    } else {
+        wire->beginTransmission(deviceAddress);
+        wire->write((uint8_t) (address >> 8));
+    }
+    wire->write((uint8_t) address);
+}
+
+void EZI2CStorage::read(uint16_t address, uint8_t* ram, uint16_t size) {
+    uint16_t done = 0;
+    while (done < size) {
+        uint16_t chunk = size - done < TRANSFER_LENGTH ? size - done : TRANSFER_LENGTH;
+        if (getAddressBytes() == 1) {
+            //small chips are read one 256 byte block at a time
+            uint16_t blockLeft = 256 - ((address + done) & 0xFF);
+            if (chunk > blockLeft) {
+                chunk = blockLeft;
+            }
+        }
+        beginAccess(address + done);
+        wire->endTransmission(false);
+        uint8_t device = deviceAddress;
+        if (getAddressBytes() == 1) {
+            device |= ((address + done) >> 8) & 0x07;
+        }
+        uint16_t received = wire->requestFrom(device, (uint8_t) chunk);
+        for (uint16_t i = 0; i < received; i++) {
+            ram[done + i] = wire->read();
+        }
+        if (received < chunk) {
+            //the chip did not answer, leave the rest as erased bytes
+            memset(ram + done + received, 0xFF, size - done - received);
+            return;
+        }
+        done += chunk;
+    }
+}
+
+uint16_t EZI2CStorage::update(uint16_t address, const uint8_t* ram, uint16_t size) {
+    uint16_t written = 0;
+    uint8_t current[TRANSFER_LENGTH];
+    uint16_t done = 0;
+    while (done < size) {
+        //one page, or as much of it as fits in the Wire buffer; a page write
+        //is one transaction, so the rest of the page takes another write cycle
+        uint16_t pageLeft = pageSize - (address + done) % pageSize;
+        uint16_t chunk = size - done < pageLeft ? size - done : pageLeft;
+        if (chunk > TRANSFER_LENGTH - getAddressBytes()) {
+            chunk = TRANSFER_LENGTH - getAddressBytes();
+        }
+        read(address + done, current, chunk);
+        //write the span from the first to the last changed byte in one cycle
+        uint16_t first = 0;
+        while (first < chunk && current[first] == ram[done + first]) {
+            first++;
+        }
+        if (first < chunk) {
+            uint16_t last = chunk - 1;
+            while (current[last] == ram[done + last]) {
+                last--;
+            }
+            if (!writePage(address + done + first, ram + done + first, last - first + 1)) {
+                return written;
+            }
+            written += last - first + 1;
+        }
+        done += chunk;
+    }
+    return written;
+}
+
+bool EZI2CStorage::writePage(uint16_t address, const uint8_t* ram, uint8_t size) {
+    beginAccess(address);
+    wire->write(ram, size);
+    wire->endTransmission();
+    return waitReady();
+}
+
+bool EZI2CStorage::waitReady() {
+    unsigned long start = millis();
+    do {
+        wire->beginTransmission(deviceAddress);
+        if (wire->endTransmission() == 0) {
+            return true;
+        }
+    } while (millis() - start < EZPROM_I2C_TIMEOUT);
+    return false;
+}
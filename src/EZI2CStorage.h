@@ -0,0 +1,76 @@
+#ifndef EZI2CSTORAGE_H
+#define EZI2CSTORAGE_H
+
+#include <Arduino.h>
+#include <Wire.h>
+#include "EZStorage.h"
+
+//the most bytes moved by one Wire transaction, limited by the buffer of the
+//Wire library (32 bytes on AVR, which leaves 30 bytes of data per write)
+#ifndef EZPROM_I2C_BUFFER
+#if defined(BUFFER_LENGTH)
+#define EZPROM_I2C_BUFFER BUFFER_LENGTH
+#elif defined(I2C_BUFFER_LENGTH)
+#define EZPROM_I2C_BUFFER I2C_BUFFER_LENGTH
+#else
+#define EZPROM_I2C_BUFFER 32
+#endif
+#endif
+
+//how long to wait for a write cycle to finish before giving up, in milliseconds
+#ifndef EZPROM_I2C_TIMEOUT
+#define EZPROM_I2C_TIMEOUT 20
+#endif
+
+/**
+ * An external I2C EEPROM of the 24LCxx family, for example the 24LC256 or the
+ * 24LC02. Writes are grouped into page writes: only the pages holding bytes
+ * that changed are written, each with a single write cycle covering the
+ * changed bytes, and the chip is polled for its acknowledge instead of waiting
+ * a fixed time. Reads are sequential reads of as many bytes as the Wire
+ * buffer holds.
+ *
+ * Chips of up to 2 KB (24LC02 to 24LC16) are addressed with one byte and the
+ * block select bits of the device address, larger chips with two bytes.
+ * Chips larger than 32 KB are not supported.
+ *
+ * Wire.begin() must be called before the backend is used:
+ * EZI2CStorage chip(32768, 64);
+ * EZPROM external(chip);
+ */
+class EZI2CStorage : public EZStorage {
+public:
+    /**
+     * @param length the size of the chip in bytes, 32768 for a 24LC256
+     * @param pageSize the size of a write page, 64 for a 24LC256, 8 for a 24LC02
+     * @param deviceAddress the I2C address of the chip, 0x50 with A0-A2 low
+     * @param wire the I2C bus the chip is connected to
+     */
+    EZI2CStorage(uint16_t length, uint8_t pageSize, uint8_t deviceAddress = 0x50, TwoWire & wire = Wire);
+
+    uint16_t length();
+    void read(uint16_t address, uint8_t * ram, uint16_t size);
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size);
+    uint8_t getCapabilities();
+    uint16_t getPageSize();
+
+private:
+    TwoWire * wire;
+    uint16_t chipLength;
+    uint8_t pageSize;
+    uint8_t deviceAddress;
+
+    // the amount of address bytes sent before data, 1 for chips of up to 2 KB
+    uint8_t getAddressBytes();
+
+    // starts a transaction with the chip and sends @address
+    void beginAccess(uint16_t address);
+
+    // writes @size bytes within one page with a single write cycle
+    bool writePage(uint16_t address, const uint8_t * ram, uint8_t size);
+
+    // polls the chip until it acknowledges, which it does once a write cycle is done
+    bool waitReady();
+};
+
+#endif /* EZI2CSTORAGE_H */
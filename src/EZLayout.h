@@ -0,0 +1,159 @@
+#ifndef EZLAYOUT_H
+#define EZLAYOUT_H
+
+#include <Arduino.h>
+#include "EZStorage.h"
+
+/**
+ * Describes one object of an #EZLayout: its ID, its type and, for arrays, the
+ * amount of elements.
+ * @param ID the ID used to access the object, unique within the layout
+ * @param T the type of the object, or of the elements of an array
+ * @param Elements the number of elements if the object is an array
+ */
+template<uint8_t ID, typename T, uint16_t Elements = 1>
+struct EZSlot {
+    static const uint8_t id = ID;
+    typedef T Type;
+    static const uint32_t size = (uint32_t) sizeof (T) * Elements;
+};
+
+//the sum of the sizes of @Slots
+template<typename... Slots>
+struct EZSlotSum {
+    static const uint32_t size = 0;
+};
+
+template<typename Slot, typename... Rest>
+struct EZSlotSum<Slot, Rest...> {
+    static const uint32_t size = Slot::size + EZSlotSum<Rest...>::size;
+};
+
+//the amount of slots in @Slots with @ID
+template<uint8_t ID, typename... Slots>
+struct EZSlotCount {
+    static const uint8_t count = 0;
+};
+
+template<uint8_t ID, typename Slot, typename... Rest>
+struct EZSlotCount<ID, Slot, Rest...> {
+    static const uint8_t count = (Slot::id == ID ? 1 : 0) + EZSlotCount<ID, Rest...>::count;
+};
+
+//true if no two slots in @Slots share an ID
+template<typename... Slots>
+struct EZSlotUnique {
+    static const bool value = true;
+};
+
+template<typename Slot, typename... Rest>
+struct EZSlotUnique<Slot, Rest...> {
+    static const bool value = EZSlotCount<Slot::id, Rest...>::count == 0 && EZSlotUnique<Rest...>::value;
+};
+
+//finds the slot with @ID in @Slots and its offset from the start of the layout
+template<uint8_t ID, uint32_t Offset, typename... Slots>
+struct EZSlotFind {
+    static_assert(ID != ID, "no slot with this ID in the layout");
+};
+
+template<bool Match, uint8_t ID, uint32_t Offset, typename Slot, typename... Rest>
+struct EZSlotFindStep {
+    typedef Slot Found;
+    static const uint32_t offset = Offset;
+};
+
+template<uint8_t ID, uint32_t Offset, typename Slot, typename... Rest>
+struct EZSlotFindStep<false, ID, Offset, Slot, Rest...> : EZSlotFind<ID, Offset + Slot::size, Rest...> {
+};
+
+template<uint8_t ID, uint32_t Offset, typename Slot, typename... Rest>
+struct EZSlotFind<ID, Offset, Slot, Rest...> : EZSlotFindStep<Slot::id == ID, ID, Offset, Slot, Rest...> {
+};
+
+/**
+ * A fixed layout of objects in EEPROM, computed at compile time. For firmware
+ * whose objects never change, this replaces the directory of EZPROM: every
+ * address and size is a constant, so #load and #save compile down to a
+ * single block read or write, and no EEPROM is spent on #ObjectData.
+ *
+ * The objects are placed one after another from @Start, in the order of their
+ * slots. It is checked at compile time that the IDs are unique and that the
+ * layout fits in EEPROM (E2END):
+ * typedef EZLayout<0,
+ *         EZSlot<0, Settings>,
+ *         EZSlot<1, char, 32>,
+ *         EZSlot<2, long> > Layout;
+ *
+ * Layout::save<0>(settings);
+ * Layout::load<1>(*name);
+ *
+ * The rest of EEPROM can still be used by EZPROM, with its region starting
+ * where the layout ends:
+ * ezprom.setRegion(Layout::end);
+ *
+ * Changing the order or the size of the slots moves the objects behind them,
+ * so data saved with an older layout is then read from the wrong address.
+ * @param Start the first address in EEPROM used by the layout
+ * @param Slots the #EZSlot of every object
+ */
+template<uint16_t Start, typename... Slots>
+class EZLayout {
+public:
+    static_assert(EZSlotUnique<Slots...>::value, "two slots of the layout share an ID");
+    static_assert(Start + EZSlotSum<Slots...>::size <= 0xFFFF, "the layout does not fit in 64 KB");
+#if defined(E2END)
+    static_assert(Start + EZSlotSum<Slots...>::size <= (uint32_t) E2END + 1, "the layout does not fit in EEPROM");
+#endif
+
+    /**
+     * The first address used by the layout.
+     */
+    static const uint16_t start = Start;
+
+    /**
+     * The amount of bytes used by the layout.
+     */
+    static const uint16_t size = EZSlotSum<Slots...>::size;
+
+    /**
+     * The address right after the layout, where EZPROM can start, see
+     * EZPROM#setRegion.
+     */
+    static const uint16_t end = Start + EZSlotSum<Slots...>::size;
+
+    /**
+     * @return the address of the object with @ID in EEPROM
+     */
+    template<uint8_t ID> static constexpr uint16_t address() {
+        return Start + EZSlotFind<ID, 0, Slots...>::offset;
+    }
+
+    /**
+     * @return the size of the object with @ID in bytes
+     */
+    template<uint8_t ID> static constexpr uint16_t sizeOf() {
+        return EZSlotFind<ID, 0, Slots...>::Found::size;
+    }
+
+    /**
+     * Saves the object with @ID, writing only the bytes that changed. Arrays
+     * are passed by their first element, as with EZPROM#save.
+     * @param src the object to be stored
+     */
+    template<uint8_t ID> static void save(const typename EZSlotFind<ID, 0, Slots...>::Found::Type & src) {
+        //calls the backend directly, without a virtual call
+        ezEEPROM.EZEEPROMStorage::update(address<ID>(), (const uint8_t *) & src, sizeOf<ID>());
+    }
+
+    /**
+     * Loads the object with @ID. Arrays are passed by their first element, as
+     * with EZPROM#load.
+     * @param dest the object which will hold the retrieved object
+     */
+    template<uint8_t ID> static void load(typename EZSlotFind<ID, 0, Slots...>::Found::Type & dest) {
+        ezEEPROM.EZEEPROMStorage::read(address<ID>(), (uint8_t *) & dest, sizeOf<ID>());
+    }
+};
+
+#endif /* EZLAYOUT_H */
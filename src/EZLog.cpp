@@ -0,0 +1,351 @@
+#include "EZLog.h"
+
+//block header: sequence number and a CRC16 over it
+#define BLOCK_HEADER_SIZE 4
+//record: id, size, data, CRC16 over the sequence number of its block, id, size and data
+#define RECORD_OVERHEAD 5
+//set in the size of a record that marks an object as removed
+#define REMOVED_FLAG 0x8000
+//the size of the RAM buffer used to read and copy records
+#define CHUNK_SIZE 16
+
+EZLog::EZLog(uint16_t start, uint16_t length, uint8_t blocks)
+: EZLog(ezEEPROM, start, length, blocks) {
+}
+
+EZLog::EZLog(EZStorage& storage, uint16_t start, uint16_t length, uint8_t blocks)
+: storage(&storage), start(start), blocks(blocks < 2 ? 2 : blocks) {
+    blockSize = length / this->blocks;
+}
+
+EZLog::~EZLog() {
+    free(entries);
+}
+
+bool EZLog::setup() {
+    entryAmount = 0;
+
+    //the active block is the valid block with the newest sequence number
+    bool found = false;
+    for (uint8_t i = 0; i < blocks; i++) {
+        uint16_t seq;
+        if (readBlockHeader(i, seq) && (!found || (int16_t) (seq - activeSeq) > 0)) {
+            active = i;
+            activeSeq = seq;
+            found = true;
+        }
+    }
+    if (!found) {
+        reset();
+        return true;
+    }
+
+    //blocks are activated in order, so replaying them from the one after the
+    //active block leaves the latest version of every object in the index
+    for (uint8_t i = 1; i <= blocks; i++) {
+        uint8_t block = (active + i) % blocks;
+        uint16_t expectedSeq = activeSeq - (blocks - i);
+        uint16_t seq;
+        if (readBlockHeader(block, seq) && seq == expectedSeq) {
+            uint16_t end = scan(block, seq);
+            if (block == active) {
+                head = end;
+            }
+        }
+    }
+
+    //finish emptying the oldest block in case a reset interrupted it
+    collect((active + 1) % blocks);
+    return false;
+}
+
+void EZLog::reset() {
+    for (uint8_t i = 1; i < blocks; i++) {
+        writeBlockHeader(i, 0, false);
+    }
+    active = 0;
+    activeSeq = 1;
+    writeBlockHeader(active, activeSeq, true);
+    head = blockStart(active) + BLOCK_HEADER_SIZE;
+    entryAmount = 0;
+}
+
+bool EZLog::remove(uint8_t id) {
+    if (find(id) == NULL) {
+        return true;
+    }
+    if (!makeRoom(RECORD_OVERHEAD)) {
+        return false;
+    }
+    writeRecord(id, REMOVED_FLAG, NULL, 0);
+    eraseEntry(id);
+    return true;
+}
+
+bool EZLog::exists(uint8_t id) {
+    return find(id) != NULL;
+}
+
+uint16_t EZLog::getSize(uint8_t id) {
+    Entry * entry = find(id);
+    return entry == NULL ? 0 : entry->size;
+}
+
+uint8_t EZLog::getObjectAmount() {
+    return entryAmount;
+}
+
+uint16_t EZLog::getMaxObjectSize() {
+    return blockSize - BLOCK_HEADER_SIZE - RECORD_OVERHEAD;
+}
+
+uint16_t EZLog::getCapacity(uint16_t size) {
+    if (size > getMaxObjectSize()) {
+        return 0;
+    }
+    //a new version is written before the old one turns into garbage
+    uint16_t versions = (blocks - 1) * ((blockSize - BLOCK_HEADER_SIZE) / (size + RECORD_OVERHEAD));
+    return versions > 0 ? versions - 1 : 0;
+}
+
+bool EZLog::saveBytes(uint8_t id, const uint8_t* src, uint16_t size) {
+    if (size > getMaxObjectSize()) {
+        return false;
+    }
+
+    Entry * entry = find(id);
+    if (entry != NULL && entry->size == size) {
+        //skip the write if the latest version is the same
+        uint16_t address = entry->address + 3;
+        uint8_t chunk[CHUNK_SIZE];
+        uint16_t i = 0;
+        while (i < size) {
+            uint16_t length = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+            storage->read(address + i, chunk, length);
+            if (memcmp(chunk, src + i, length) != 0) {
+                break;
+            }
+            i += length;
+        }
+        if (i >= size) {
+            return true;
+        }
+    }
+
+    if (!makeRoom(size + RECORD_OVERHEAD)) {
+        return false;
+    }
+    uint16_t address = writeRecord(id, size, src, 0);
+    return setEntry(id, address, size);
+}
+
+bool EZLog::loadBytes(uint8_t id, uint8_t* dest) {
+    Entry * entry = find(id);
+    if (entry == NULL) {
+        return false;
+    }
+    storage->read(entry->address + 3, dest, entry->size);
+    return true;
+}
+
+EZLog::Entry * EZLog::find(uint8_t id) {
+    for (uint8_t i = 0; i < entryAmount; i++) {
+        if (entries[i].id == id) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+bool EZLog::setEntry(uint8_t id, uint16_t address, uint16_t size) {
+    Entry * entry = find(id);
+    if (entry == NULL) {
+        if (entryAmount == entryCapacity) {
+            //grow in steps of 8 so adding objects rarely reallocates
+            uint16_t capacity = entryCapacity + 8;
+            if (capacity > 255) {
+                capacity = 255;
+            }
+            Entry * grown = (Entry *) realloc(entries, sizeof (Entry) * capacity);
+            if (grown == NULL) {
+                return false;
+            }
+            entries = grown;
+            entryCapacity = capacity;
+        }
+        entry = &entries[entryAmount++];
+        entry->id = id;
+    }
+    entry->address = address;
+    entry->size = size;
+    return true;
+}
+
+void EZLog::eraseEntry(uint8_t id) {
+    Entry * entry = find(id);
+    if (entry != NULL) {
+        *entry = entries[--entryAmount];
+    }
+}
+
+uint16_t EZLog::blockStart(uint8_t block) {
+    return start + block * blockSize;
+}
+
+bool EZLog::readBlockHeader(uint8_t block, uint16_t& seq) {
+    uint8_t header[BLOCK_HEADER_SIZE];
+    storage->read(blockStart(block), header, BLOCK_HEADER_SIZE);
+    seq = header[0] | (header[1] << 8);
+    uint16_t check = header[2] | (header[3] << 8);
+    return check == headerCrc(block, seq);
+}
+
+void EZLog::writeBlockHeader(uint8_t block, uint16_t seq, bool valid) {
+    uint16_t crc = headerCrc(block, seq);
+    if (!valid) {
+        crc = ~crc;
+    }
+    uint8_t header[BLOCK_HEADER_SIZE] = {(uint8_t) seq, (uint8_t) (seq >> 8), (uint8_t) crc, (uint8_t) (crc >> 8)};
+    storage->update(blockStart(block), header, BLOCK_HEADER_SIZE);
+}
+
+uint16_t EZLog::scan(uint8_t block, uint16_t seq) {
+    uint16_t address = blockStart(block) + BLOCK_HEADER_SIZE;
+    uint16_t end = blockStart(block) + blockSize;
+    while (address + RECORD_OVERHEAD <= end) {
+        uint8_t header[3];
+        storage->read(address, header, 3);
+        uint8_t id = header[0];
+        uint16_t sizeField = header[1] | (header[2] << 8);
+        uint16_t size = sizeField & ~REMOVED_FLAG;
+        if (size > end - address - RECORD_OVERHEAD) {
+            break;
+        }
+        uint16_t crc = EZCrc::crc16(header, 3, seqCrc(seq));
+        uint8_t chunk[CHUNK_SIZE];
+        for (uint16_t i = 0; i < size; i += CHUNK_SIZE) {
+            uint16_t length = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+            storage->read(address + 3 + i, chunk, length);
+            crc = EZCrc::crc16(chunk, length, crc);
+        }
+        uint8_t stored[2];
+        storage->read(address + size + 3, stored, 2);
+        uint16_t check = stored[0] | (stored[1] << 8);
+        if (check != crc) {
+            //end of the log, or a record cut short by a reset
+            break;
+        }
+        if (sizeField & REMOVED_FLAG) {
+            eraseEntry(id);
+        } else {
+            setEntry(id, address, size);
+        }
+        address += size + RECORD_OVERHEAD;
+    }
+    return address;
+}
+
+bool EZLog::makeRoom(uint16_t size) {
+    //a save that does not fit must not wear the region with rotations first
+    if (!hasRoom(size)) {
+        return false;
+    }
+    for (uint8_t i = 0; i <= blocks; i++) {
+        if (blockStart(active) + blockSize - head >= size) {
+            return true;
+        }
+        rotate();
+    }
+    return false;
+}
+
+bool EZLog::hasRoom(uint16_t size) {
+    //replays the rotations of #makeRoom without writing: the block of every
+    //object and the head are tracked here instead
+    uint8_t entryBlocks[entryAmount];
+    for (uint8_t i = 0; i < entryAmount; i++) {
+        entryBlocks[i] = (entries[i].address - start) / blockSize;
+    }
+    uint8_t block = active;
+    uint16_t used = head - blockStart(active);
+    //every rotation frees the oldest block, so after a full turn all live
+    //objects are packed together
+    for (uint8_t i = 0; i <= blocks; i++) {
+        if (blockSize - used >= size) {
+            return true;
+        }
+        block = (block + 1) % blocks;
+        used = BLOCK_HEADER_SIZE;
+        uint8_t oldest = (block + 1) % blocks;
+        for (uint8_t j = 0; j < entryAmount; j++) {
+            if (entryBlocks[j] == oldest && oldest != block) {
+                entryBlocks[j] = block;
+                used += entries[j].size + RECORD_OVERHEAD;
+            }
+        }
+        if (used > blockSize) {
+            //the live objects no longer fit in one block
+            return false;
+        }
+    }
+    return false;
+}
+
+void EZLog::rotate() {
+    //the next block holds no live objects, see #collect
+    active = (active + 1) % blocks;
+    activeSeq++;
+    writeBlockHeader(active, activeSeq, true);
+    head = blockStart(active) + BLOCK_HEADER_SIZE;
+    collect((active + 1) % blocks);
+}
+
+void EZLog::collect(uint8_t block) {
+    if (block == active) {
+        return;
+    }
+    uint16_t begin = blockStart(block);
+    uint16_t end = begin + blockSize;
+    for (uint8_t i = 0; i < entryAmount; i++) {
+        Entry & entry = entries[i];
+        if (entry.address >= begin && entry.address < end) {
+            entry.address = writeRecord(entry.id, entry.size, NULL, entry.address + 3);
+        }
+    }
+}
+
+uint16_t EZLog::writeRecord(uint8_t id, uint16_t sizeField, const uint8_t* src, uint16_t from) {
+    uint16_t address = head;
+    uint16_t size = sizeField & ~REMOVED_FLAG;
+    uint8_t header[3] = {id, (uint8_t) sizeField, (uint8_t) (sizeField >> 8)};
+    uint16_t crc = EZCrc::crc16(header, 3, seqCrc(activeSeq));
+    storage->update(head, header, 3);
+    head += 3;
+    uint8_t chunk[CHUNK_SIZE];
+    for (uint16_t i = 0; i < size; i += CHUNK_SIZE) {
+        uint16_t length = size - i < CHUNK_SIZE ? size - i : CHUNK_SIZE;
+        const uint8_t * data = chunk;
+        if (src != NULL) {
+            data = src + i;
+        } else {
+            storage->read(from + i, chunk, length);
+        }
+        crc = EZCrc::crc16(data, length, crc);
+        storage->update(head, data, length);
+        head += length;
+    }
+    //the CRC is written last, so a record is only valid once it is complete
+    uint8_t check[2] = {(uint8_t) crc, (uint8_t) (crc >> 8)};
+    storage->update(head, check, 2);
+    head += 2;
+    return address;
+}
+
+uint16_t EZLog::seqCrc(uint16_t seq) {
+    uint8_t bytes[2] = {(uint8_t) seq, (uint8_t) (seq >> 8)};
+    return EZCrc::crc16(bytes, 2);
+}
+
+uint16_t EZLog::headerCrc(uint8_t block, uint16_t seq) {
+    return EZCrc::crc16(&block, 1, seqCrc(seq));
+}
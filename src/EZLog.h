@@ -0,0 +1,173 @@
+#ifndef EZLOG_H
+#define EZLOG_H
+
+#include <Arduino.h>
+#include "EZStorage.h"
+#include "EZCrc.h"
+
+/**
+ * EZLog is a log-structured, wear-leveled alternative to EZPROM for objects
+ * that are updated often. It offers the same #save and #load calls, but
+ * instead of overwriting an object in place, every save appends a new version
+ * of the object to a log that moves through the whole region. Old versions are
+ * garbage-collected as the log wraps around, so every byte of the region is
+ * written about as often as every other byte.
+ *
+ * The region is split into blocks. Objects are appended to the active block;
+ * when it is full, the next block becomes active and the live objects of the
+ * oldest block are copied into it, which frees the oldest block for later.
+ * One block is always kept free, so the space available for objects is
+ * (blocks - 1) blocks. Each version of an object costs 5 extra bytes: its ID,
+ * its size and a CRC16, which also detects versions that were cut short by a
+ * reset. An object cannot be larger than a block minus 9 bytes. Versions
+ * cannot span blocks, so the objects may fill less than (blocks - 1) blocks; a
+ * save that would not fit after the log wraps around fails before anything is
+ * written. With 2 blocks, every change of block copies all live objects, and
+ * they must fit in one block together with the version being saved, so use
+ * at least 3 blocks where the region allows it.
+ *
+ * The IDs of EZLog are separate from the IDs of EZPROM. To use both, give them
+ * regions that do not overlap, see EZPROM#setRegion:
+ * ezprom.setRegion(0, 768);
+ * EZLog log(768, 256);
+ *
+ * The latest address of every object is kept in RAM, 5 bytes per object.
+ */
+class EZLog {
+public:
+    /**
+     * @param start the first address in EEPROM used by the log
+     * @param length the length of the region in bytes
+     * @param blocks the number of blocks the region is split into, at least 2
+     */
+    EZLog(uint16_t start, uint16_t length, uint8_t blocks = 4);
+
+    /**
+     * Creates a log in a region of @storage instead of the internal EEPROM,
+     * see #EZStorage.
+     * @param storage the backend holding the log; it must outlive the EZLog
+     */
+    EZLog(EZStorage & storage, uint16_t start, uint16_t length, uint8_t blocks = 4);
+    ~EZLog();
+
+    /**
+     * Mounts the log: finds the active block and the latest version of every
+     * object. If no valid log is found, the region is formatted. Must be
+     * called before any other method.
+     * @return true if the region was formatted, false if an existing log was found
+     */
+    bool setup();
+
+    /**
+     * Clears all objects from the log.
+     */
+    void reset();
+
+    /**
+     * Stores an object and assigns it the given ID, see EZPROM#save. Saving an
+     * object that did not change writes nothing.
+     * @return true if the save was successful, false if there was no space
+     */
+    template<typename T>
+    bool save(uint8_t id, const T& src, uint16_t elements = 1) {
+        return saveBytes(id, (const uint8_t *) & src, sizeof (T) * elements);
+    }
+
+    /**
+     * Loads the latest version of the object with the specified ID, see EZPROM#load.
+     * @return true if the object was retrieved, false if the ID does not exist
+     */
+    template<typename T> bool load(uint8_t id, T& dest) {
+        return loadBytes(id, (uint8_t *) & dest);
+    }
+
+    /**
+     * Removes the object with the specified ID. This appends a small record
+     * that marks the object as removed.
+     * @return true if the object was removed or did not exist, false if
+     * there was no space for the record
+     */
+    bool remove(uint8_t id);
+
+    bool exists(uint8_t id);
+
+    /**
+     * @return the size of the object with the specified ID, 0 if it does not exist
+     */
+    uint16_t getSize(uint8_t id);
+
+    /**
+     * @return the amount of objects currently stored in the log
+     */
+    uint8_t getObjectAmount();
+
+    /**
+     * @return the largest object that can be stored
+     */
+    uint16_t getMaxObjectSize();
+
+    /**
+     * Calculates how many objects of @size bytes the log can hold while each
+     * of them can still be saved again: the versions that fit in (blocks - 1)
+     * blocks, since versions cannot span blocks, less one for the version
+     * being saved. Saves of objects larger than @size may fail sooner.
+     * @return the amount of objects, 0 if not even one fits
+     */
+    uint16_t getCapacity(uint16_t size);
+
+private:
+
+    struct Entry {
+        uint8_t id;
+        // address of the latest record of this object
+        uint16_t address;
+        uint16_t size;
+    };
+
+    EZStorage * storage;
+    uint16_t start;
+    uint8_t blocks;
+    uint16_t blockSize;
+    uint8_t active = 0;
+    uint16_t activeSeq = 0;
+    // the address at which the next record is written
+    uint16_t head = 0;
+    Entry * entries = NULL;
+    uint8_t entryAmount = 0;
+    uint8_t entryCapacity = 0;
+
+    bool saveBytes(uint8_t id, const uint8_t * src, uint16_t size);
+    bool loadBytes(uint8_t id, uint8_t * dest);
+
+    Entry * find(uint8_t id);
+    bool setEntry(uint8_t id, uint16_t address, uint16_t size);
+    void eraseEntry(uint8_t id);
+
+    uint16_t blockStart(uint8_t block);
+    bool readBlockHeader(uint8_t block, uint16_t & seq);
+    void writeBlockHeader(uint8_t block, uint16_t seq, bool valid);
+    // reads the records of @block into the index, returns the end of the last valid record
+    uint16_t scan(uint8_t block, uint16_t seq);
+
+    // rotates blocks until the active block has @size free bytes
+    bool makeRoom(uint16_t size);
+    // true if #makeRoom would succeed, found without writing anything
+    bool hasRoom(uint16_t size);
+    // activates the next block and empties the oldest one into it
+    void rotate();
+    // copies the live records of @block into the active block
+    void collect(uint8_t block);
+    /**
+     * Appends a record to the active block. The data is taken from @src, or
+     * from EEPROM at @from if @src is NULL.
+     * @return the address of the record
+     */
+    uint16_t writeRecord(uint8_t id, uint16_t sizeField, const uint8_t * src, uint16_t from);
+
+    // the CRC16 of a sequence number, which starts the CRC of every record of its block
+    static uint16_t seqCrc(uint16_t seq);
+    // the CRC16 stored in the header of @block
+    static uint16_t headerCrc(uint8_t block, uint16_t seq);
+};
+
+#endif /* EZLOG_H */
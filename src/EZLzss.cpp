@@ -0,0 +1,92 @@
+#include "EZLzss.h"
+
+uint16_t EZLzss::compress(const uint8_t* src, uint16_t size, EZPROM::Writer& writer) {
+    uint16_t start = writer.position();
+    writer.putObject(size);
+    //a group is written once its flag byte is complete
+    uint8_t group[1 + 8 * 2];
+    uint8_t groupLength = 1;
+    uint8_t tokens = 0;
+    group[0] = 0;
+    uint16_t position = 0;
+    while (position < size) {
+        //find the longest match in the window, the nearest one if several are as long
+        uint16_t bestLength = 0;
+        uint16_t bestDistance = 0;
+        uint16_t limit = size - position < MAX_MATCH ? size - position : MAX_MATCH;
+        uint16_t farthest = position < WINDOW ? position : WINDOW;
+        for (uint16_t distance = 1; distance <= farthest && bestLength < limit; distance++) {
+            const uint8_t * candidate = src + position - distance;
+            //a longer match must also match one byte past the best so far
+            if (candidate[bestLength] != src[position + bestLength] || candidate[0] != src[position]) {
+                continue;
+            }
+            uint16_t length = 1;
+            while (length < limit && candidate[length] == src[position + length]) {
+                length++;
+            }
+            if (length > bestLength) {
+                bestLength = length;
+                bestDistance = distance;
+            }
+        }
+        if (bestLength >= MIN_MATCH) {
+            group[0] |= 1 << tokens;
+            group[groupLength++] = bestDistance - 1;
+            group[groupLength++] = bestLength - MIN_MATCH;
+            position += bestLength;
+        } else {
+            group[groupLength++] = src[position++];
+        }
+        if (++tokens == 8) {
+            writer.write(group, groupLength);
+            group[0] = 0;
+            groupLength = 1;
+            tokens = 0;
+        }
+    }
+    if (tokens > 0) {
+        writer.write(group, groupLength);
+    }
+    return writer.position() - start;
+}
+
+uint16_t EZLzss::getSize(EZPROM::Reader& reader) {
+    uint16_t size = 0;
+    reader.getObject(size);
+    return size;
+}
+
+uint16_t EZLzss::getMaxSize(uint16_t packed) {
+    if (packed < 2) {
+        return 0;
+    }
+    //every 2 bytes after the size are at most one match
+    uint32_t size = (uint32_t) (packed - 2) / 2 * MAX_MATCH + MAX_MATCH;
+    return size > 0xFFFF ? 0xFFFF : size;
+}
+
+void EZLzss::decompress(EZPROM::Reader& reader, uint8_t* dest, uint16_t size) {
+    uint16_t position = 0;
+    while (position < size) {
+        uint8_t flags = 0;
+        reader.getObject(flags);
+        for (uint8_t token = 0; token < 8 && position < size; token++) {
+            if (!(flags & (1 << token))) {
+                reader.getObject(dest[position++]);
+                continue;
+            }
+            uint8_t match[2];
+            reader.read(match, sizeof (match));
+            uint16_t distance = match[0] + 1;
+            uint16_t length = match[1] + MIN_MATCH;
+            if (length > size - position) {
+                length = size - position;
+            }
+            for (uint16_t i = 0; i < length; i++, position++) {
+                //a match reaching before the start is corrupted, read it as 0
+                dest[position] = distance <= position ? dest[position - distance] : 0;
+            }
+        }
+    }
+}
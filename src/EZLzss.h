@@ -0,0 +1,61 @@
+#ifndef EZLZSS_H
+#define EZLZSS_H
+
+#include <Arduino.h>
+#include "EZPROM.h"
+
+/**
+ * The LZSS codec used by EZPROM for compressed objects, see
+ * EZPROM#setCompression. A compressed object starts with its uncompressed
+ * size (2 bytes), followed by groups of a flag byte and 8 tokens. Bit n of the
+ * flag byte, starting from the lowest, is set if token n is a match and clear
+ * if it is a literal byte. A match is 2 bytes: the distance back to the
+ * repeated bytes minus 1, then their length minus #MIN_MATCH.
+ *
+ * With a window of 256 bytes, matches are found by a plain search, without
+ * hash tables, and decompressing into RAM needs no buffer besides the output.
+ */
+class EZLzss {
+public:
+
+    /**
+     * The farthest a match can reach back.
+     */
+    static const uint16_t WINDOW = 256;
+
+    /**
+     * The shortest match worth encoding; shorter repeats are literals.
+     */
+    static const uint8_t MIN_MATCH = 3;
+
+    /**
+     * The longest match.
+     */
+    static const uint16_t MAX_MATCH = MIN_MATCH + 255;
+
+    /**
+     * Compresses @size bytes of @src into @writer.
+     * @return the compressed size, also counting bytes @writer dropped
+     */
+    static uint16_t compress(const uint8_t * src, uint16_t size, EZPROM::Writer & writer);
+
+    /**
+     * Reads the uncompressed size at the start of a compressed object.
+     */
+    static uint16_t getSize(EZPROM::Reader & reader);
+
+    /**
+     * @return the largest uncompressed size that a compressed object of
+     * @packed bytes can hold, to reject sizes read from a corrupted object
+     */
+    static uint16_t getMaxSize(uint16_t packed);
+
+    /**
+     * Decompresses the object read by @reader into @dest, after #getSize was
+     * called. Corrupted input never writes more than @size bytes.
+     * @param size the uncompressed size, as returned by #getSize
+     */
+    static void decompress(EZPROM::Reader & reader, uint8_t * dest, uint16_t size);
+};
+
+#endif /* EZLZSS_H */
@@ -1,187 +1,2199 @@
-#include "EZPROM.h"
-
-EZPROM ezprom;
-
-void EZPROM::reset() {
-    EEPROM.put(EEPROM.length() - sizeof (uint8_t), (uint8_t) 0);
-}
-
-bool EZPROM::setup(uint16_t uniqueInt, uint8_t id = UNIQUE_INT_ID) {
-	if (!isValid(uniqueInt, id)) {
-		reset();
-		setUniqueId(uniqueInt, id);
-		return true;
-	}
-	return false;
-}
-
-bool EZPROM::isValid(uint16_t uniqueInt, uint8_t id = UNIQUE_INT_ID) {
-	uint16_t curInt = 0;
-	if (ezprom.exists(id)
-			&& ezprom.getObjectData(id).size == sizeof(uint16_t)) {
-		ezprom.load(id, curInt);
-	}
-	return curInt == uniqueInt;
-}
-
-void EZPROM::setUniqueId(uint16_t uniqueInt, uint8_t id = UNIQUE_INT_ID) {
-	ezprom.save(id, uniqueInt);
-}
-
-bool EZPROM::saveSerial(uint8_t id, const Serializable* src) {
-    uint16_t size = src->size();
-    uint8_t stream[size];
-    uint16_t index = 0;
-    src->serialize(stream, index);
-    return save(id, * stream, size);
-}
-
-bool EZPROM::loadSerial(uint8_t id, Serializable* dest) {
-    //load object data
-    uint8_t objectAmount = getObjectAmount();
-    ObjectData objects[objectAmount];
-    loadObjectData(objects, objectAmount);
-
-    //check if id exists
-    uint8_t index = 0;
-    bool hasId = false;
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        if (objects[i].id == id) {
-            index = i;
-            hasId = true;
-            break;
-        }
-    }
-
-    if (hasId) {
-        uint8_t stream[objects[index].size];
-        uint16_t address = getAddress(objects, index);
-        for (uint16_t i = 0; i < objects[index].size; i++) {
-            stream[i] = EEPROM.read(address + i);
-        }
-        uint16_t serialIndex = 0;
-        dest->deserialize(stream, serialIndex);
-        return true;
-    }
-    return false;
-}
-
-bool EZPROM::exists(uint8_t id) {
-    //load object data
-    uint8_t objectAmount = getObjectAmount();
-    ObjectData objects[objectAmount];
-    loadObjectData(objects, objectAmount);
-
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        if (objects[i].id == id) {
-            return true;
-        }
-    }
-    return false;
-}
-
-uint16_t EZPROM::getAddress(uint8_t id) {
-    //load object data
-    uint8_t objectAmount = getObjectAmount();
-    ObjectData objects[objectAmount];
-    loadObjectData(objects, objectAmount);
-
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        if (objects[i].id == id) {
-            return getAddress(objects, i);
-        }
-    }
-    return EEPROM.length();
-}
-
-uint16_t EZPROM::getAddress(ObjectData* objects, uint8_t index) {
-    uint16_t address = 0;
-    for (uint8_t i = 0; i < index; i++) {
-        address += objects[i].size;
-    }
-    return address;
-}
-
-uint8_t EZPROM::getObjectAmount() {
-    //read amount from last address on EEPROM
-    uint8_t objectAmt = 0;
-    EEPROM.get(EEPROM.length() - sizeof (uint8_t), objectAmt);
-    return objectAmt;
-}
-
-EZPROM::ObjectData EZPROM::getObjectData(uint8_t id) {
-    //load object data
-    uint8_t objectAmount = getObjectAmount();
-    ObjectData objects[objectAmount];
-    loadObjectData(objects, objectAmount);
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        if (objects[i].id == id) {
-            return objects[i];
-        }
-    }
-    ObjectData badObject;
-    badObject.id = id;
-    badObject.size = 0;
-    return badObject;
-}
-
-void EZPROM::remove(uint8_t id) {
-    //load object data
-    uint8_t objectAmount = getObjectAmount();
-    ObjectData objects[objectAmount];
-    loadObjectData(objects, objectAmount);
-
-    //check if id exists
-    uint8_t index = 0;
-    bool hasId = false;
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        if (objects[i].id == id) {
-            index = i;
-            hasId = true;
-            break;
-        }
-    }
-
-    if (hasId) {
-        ObjectData updatedObjects[objectAmount - 1];
-        for (uint8_t i = 0; i < objectAmount; i++) {
-            if (i < index) {
-                updatedObjects[i] = objects[i];
-            } else if (i > index) {
-                updatedObjects[i - 1] = objects[i];
-            }
-        }
-        for (uint8_t i = index; i < objectAmount - 1; i++) {
-            uint16_t oldAddress = getAddress(objects, i + 1);
-            uint16_t newAddress = getAddress(updatedObjects, i);
-            for (uint16_t j = 0; j < updatedObjects[i].size; j++) {
-                EEPROM.update(newAddress + j, EEPROM.read(oldAddress + j));
-            }
-        }
-        saveObjectData(updatedObjects, objectAmount - 1);
-    }
-}
-
-void EZPROM::setOverwriteIfSizeDifferent(bool b) {
-    overwriteDiffSize = b;
-}
-
-void EZPROM::saveObjectData(ObjectData* objectData, uint8_t objectAmount) {
-    //calculate starting address
-    uint16_t startingAddress = EEPROM.length() - (sizeof (uint8_t) + sizeof (ObjectData) * objectAmount);
-    //save object data
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        EEPROM.put(startingAddress + (i * sizeof (ObjectData)), objectData[i]);
-    }
-    //save length of array
-    EEPROM.put(EEPROM.length() - sizeof (uint8_t), objectAmount);
-}
-
-void EZPROM::loadObjectData(ObjectData* objectData, uint8_t objectAmount) {
-    //load all objects
-    uint16_t startingAddress = EEPROM.length() - (sizeof (uint8_t) + sizeof (ObjectData) * objectAmount);
-    for (uint8_t i = 0; i < objectAmount; i++) {
-        EEPROM.get(startingAddress + (i * sizeof (ObjectData)), objectData[i]);
-    }
-}
-
+#include "EZPROM.h"
+#include "EZLzss.h"
+
+//the CRC of an empty object
+#if EZPROM_CRC_BITS == 16
+#define CRC_START 0xFFFF
+#else
+#define CRC_START 0
+#endif
+
+#if EZPROM_COMPACT_DIRECTORY
+//written in front of the amount byte by #reset, little endian. A legacy
+//directory can end in the same bytes by chance, so the entries are checked
+//too, see #isCompactDirectory
+#define DIRECTORY_MARKER 0x5AA5
+//the amount byte and the marker
+#define DIRECTORY_TRAILER 3
+//in the head byte of an entry: the flags, the amount of size bytes in front of
+//the id, then the low bits of the size
+#define HEAD_FLAGS_SHIFT 5
+#define HEAD_EXTRA_SHIFT 3
+#define HEAD_SIZE_BITS 3
+#else
+//the amount byte
+#define DIRECTORY_TRAILER 1
+#endif
+
+#if EZPROM_STATS
+//adds @amount to a counter of EZPROM#getStats
+#define STATS_ADD(counter, amount) stats.counter += (amount)
+//times the public call it is used in, see EZPROM#getStats
+#define STATS_OPERATION() Operation operation(*this)
+#else
+#define STATS_ADD(counter, amount) ((void) (amount))
+#define STATS_OPERATION()
+#endif
+
+EZPROM ezprom;
+
+namespace {
+
+// streams the compressed bytes of an object to EEPROM, see EZPROM#setCompression
+class Compressed : public EZPROM::Serializable {
+public:
+
+    Compressed(const uint8_t* src, uint16_t size) : src(src), length(size) {
+    }
+
+    void serialize(EZPROM::Writer& writer) {
+        EZLzss::compress(src, length, writer);
+    }
+
+    void deserialize(EZPROM::Reader&) {
+        //never loaded, EZPROM#load decompresses into the destination itself
+    }
+
+private:
+    const uint8_t * src;
+    uint16_t length;
+};
+
+}
+
+EZPROM::EZPROM() : storage(&ezEEPROM) {
+}
+
+EZPROM::EZPROM(EZStorage& storage) : storage(&storage) {
+}
+
+EZPROM::~EZPROM() {
+    disableWriteBack();
+    //a batch left open is committed, so its objects are not lost
+    if (directoryDirty) {
+        writeObjectData(cachedObjects, cachedAmount);
+    }
+    free(cachedObjects);
+    free(cachedAddresses);
+    free(cachedOrder);
+}
+
+void EZPROM::reset() {
+    while (writeBackAmount > 0) {
+        dropWriteBack(0);
+    }
+    updateObject(getLength() - sizeof (uint8_t), (uint8_t) 0);
+    defragMoving = false;
+#if EZPROM_COMPACT_DIRECTORY
+    updateObject(getLength() - DIRECTORY_TRAILER, (uint16_t) DIRECTORY_MARKER);
+#endif
+    directoryDirty = false;
+    if (cacheEnabled && reserveCache(0)) {
+        cachedAmount = 0;
+        updateCacheIndex();
+        cacheValid = true;
+    }
+}
+
+bool EZPROM::setup(uint16_t uniqueInt, uint8_t id) {
+	if (!migrateDirectory() || !isValid(uniqueInt, id)) {
+		reset();
+		setUniqueId(uniqueInt, id);
+		return true;
+	}
+	return false;
+}
+
+bool EZPROM::migrateDirectory() {
+#if EZPROM_COMPACT_DIRECTORY
+    if (isCompactDirectory()) {
+        return true;
+    }
+    //read the directory as the legacy format, which must look sane
+    uint8_t objectAmount = readEntryAmount();
+    uint16_t legacySize = 1 + sizeof (StoredObjectData) * objectAmount;
+    if (legacySize > getLength()) {
+        return false;
+    }
+    ObjectData objects[objectAmount];
+    uint32_t dataSize = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        StoredObjectData stored;
+        readObject(getLength() - legacySize + i * sizeof (StoredObjectData), stored);
+        objects[i].id = stored.id;
+        objects[i].size = stored.size & MAX_OBJECT_SIZE;
+        objects[i].flags = stored.size >> 13;
+#if EZPROM_CRC_BITS > 0
+        objects[i].crc = stored.crc;
+#endif
+        dataSize += objects[i].size;
+        if (dataSize > (uint16_t) (getLength() - legacySize)) {
+            return false;
+        }
+    }
+    //entries of objects over 2 KB are a byte longer than on AVR
+    if (dataSize + getDirectorySize(objects, objectAmount) > getLength()) {
+        return false;
+    }
+    writeObjectData(objects, objectAmount);
+    updateObject(getLength() - DIRECTORY_TRAILER, (uint16_t) DIRECTORY_MARKER);
+    if (!directoryDirty) {
+        cacheValid = false;
+    }
+#endif
+    return true;
+}
+
+#if EZPROM_COMPACT_DIRECTORY
+
+bool EZPROM::isCompactDirectory() {
+    uint16_t marker = 0;
+    readObject(getLength() - DIRECTORY_TRAILER, marker);
+    if (marker != DIRECTORY_MARKER) {
+        return false;
+    }
+    //the entries must fit in front of the trailer, with room for the objects,
+    //and name every live id once
+    uint8_t objectAmount = readEntryAmount();
+    uint8_t ids[32] = {};
+    uint32_t dataSize = 0;
+    uint16_t cursor = getFirstEntry(objectAmount);
+    ObjectData first;
+    uint16_t firstAddress = 0xFFFF;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (cursor < 2) {
+            return false;
+        }
+        ObjectData object;
+        readEntry(cursor, object);
+        if (!(object.flags & DEAD_FLAG)) {
+            if (ids[object.id >> 3] & (1 << (object.id & 7))) {
+                return false;
+            }
+            ids[object.id >> 3] |= 1 << (object.id & 7);
+        }
+        if (object.flags == 0 && firstAddress == 0xFFFF) {
+            first = object;
+            firstAddress = dataSize;
+        }
+        dataSize += object.size;
+        if (dataSize > cursor) {
+            return false;
+        }
+    }
+#if EZPROM_CRC_BITS > 0
+    //a legacy directory can end in the marker by chance and still read as
+    //sane entries; then the CRC of its first object tells the formats apart
+    if (firstAddress != 0xFFFF && readCrc(firstAddress, first.size) != getCrc(first)
+            && hasLegacyCrc()) {
+        return false;
+    }
+#endif
+    return true;
+}
+
+#if EZPROM_CRC_BITS > 0
+
+bool EZPROM::hasLegacyCrc() {
+    uint8_t objectAmount = readEntryAmount();
+    uint16_t legacySize = 1 + sizeof (StoredObjectData) * objectAmount;
+    if (legacySize > getLength()) {
+        return false;
+    }
+    uint32_t address = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        StoredObjectData stored;
+        readObject(getLength() - legacySize + i * sizeof (StoredObjectData), stored);
+        uint16_t size = stored.size & MAX_OBJECT_SIZE;
+        if (address + size > (uint16_t) (getLength() - legacySize)) {
+            return false;
+        }
+        if ((stored.size >> 13) == 0) {
+            return readCrc(address, size) == stored.crc;
+        }
+        address += size;
+    }
+    return false;
+}
+
+#endif
+
+#endif
+
+bool EZPROM::isValid(uint16_t uniqueInt, uint8_t id) {
+	uint16_t curInt = 0;
+	if (exists(id)
+			&& getObjectData(id).size == sizeof(uint16_t)) {
+		load(id, curInt);
+	}
+	return curInt == uniqueInt;
+}
+
+void EZPROM::setUniqueId(uint16_t uniqueInt, uint8_t id) {
+	save(id, uniqueInt);
+}
+
+bool EZPROM::saveSerial(uint8_t id, const Serializable* src) {
+    STATS_OPERATION();
+    //#size and #serialize are not const, but must not modify the object
+    Serializable * serializable = const_cast<Serializable *> (src);
+    syncWriteBack(id, true);
+    uint16_t size = serializable->size();
+    if (size == 0) {
+        return saveStream(id, serializable);
+    }
+    if (size > MAX_OBJECT_SIZE) {
+        return false;
+    }
+    if (serializable->isBuffered()) {
+        uint8_t * buffer = (uint8_t *) malloc(size);
+        if (buffer == NULL) {
+            return false;
+        }
+        uint16_t index = 0;
+        static_cast<BufferSerializable *> (serializable)->serialize(buffer, index);
+        bool saved = compression ? saveCompressed(id, buffer, size) : saveObject(id, size, buffer, NULL);
+        free(buffer);
+        return saved;
+    }
+    if (compression) {
+        //the compressor needs the whole object in RAM
+        uint8_t * buffer = (uint8_t *) malloc(size);
+        if (buffer == NULL) {
+            return false;
+        }
+        Writer writer(buffer, size);
+        serializable->serialize(writer);
+        bool saved = saveCompressed(id, buffer, size);
+        free(buffer);
+        return saved;
+    }
+    return saveObject(id, size, NULL, serializable);
+}
+
+bool EZPROM::saveBytes(uint8_t id, const uint8_t* src, uint16_t size) {
+    STATS_OPERATION();
+    if (writeBack != NULL && saveWriteBack(id, src, size)) {
+        return true;
+    }
+    if (compression) {
+        return saveCompressed(id, src, size);
+    }
+    return saveObject(id, size, src, NULL);
+}
+
+bool EZPROM::saveCompressed(uint8_t id, const uint8_t* src, uint16_t size) {
+    //compress once without writing, only to learn the compressed size
+    Writer counter(*this, 0, 0);
+    uint16_t packed = EZLzss::compress(src, size, counter);
+    if (packed >= size) {
+        return saveObject(id, size, src, NULL);
+    }
+    Compressed compressed(src, size);
+    return saveObject(id, packed, NULL, &compressed, COMPRESSED_FLAG);
+}
+
+bool EZPROM::loadBytes(uint8_t id, uint8_t* dest) {
+    STATS_OPERATION();
+    if (writeBack != NULL) {
+        flushExpired();
+        uint8_t index = findWriteBack(id);
+        if (index < writeBackAmount) {
+            touchWriteBack(index);
+            memcpy(dest, writeBackPool + writeBack[0].offset, writeBack[0].size);
+            return true;
+        }
+    }
+    ObjectData object;
+    uint16_t address;
+    return lookup(id, object, address) && loadObject(object, address, dest, 0xFFFF);
+}
+
+bool EZPROM::loadObject(const ObjectData& object, uint16_t address, uint8_t* dest, uint16_t capacity) {
+    if (object.flags & COMPRESSED_FLAG) {
+        //compressed objects are not cached, their size would not match
+        Reader reader(*this, address, object.size);
+        uint16_t size = EZLzss::getSize(reader);
+        if (size > capacity || size > MAX_OBJECT_SIZE || size > EZLzss::getMaxSize(object.size)) {
+            return false;
+        }
+        EZLzss::decompress(reader, dest, size);
+        return true;
+    }
+    if (object.size > capacity) {
+        return false;
+    }
+    readBlock(address, dest, object.size);
+    //loads only fill free space, they never evict
+    if (writeBack != NULL && addWriteBack(object.id, object.size, false)) {
+        memcpy(writeBackPool + writeBack[0].offset, dest, object.size);
+    }
+    return true;
+}
+
+bool EZPROM::saveMany(const Item* items, uint8_t amount) {
+    STATS_OPERATION();
+    //the directory is read into the cache once and written once by #commitBatch
+    Batch batch(*this);
+    bool saved = true;
+    for (uint8_t i = 0; i < amount; i++) {
+        if (!saveBytes(items[i].id, (const uint8_t *) items[i].data, items[i].size)) {
+            saved = false;
+        }
+    }
+    return saved;
+}
+
+uint8_t EZPROM::loadMany(Item* items, uint8_t amount) {
+    STATS_OPERATION();
+    if (amount == 0) {
+        return 0;
+    }
+    uint8_t loaded = 0;
+    //bit n is set once items[n] was served by the write-back cache
+    uint8_t done[(amount + 7) / 8];
+    memset(done, 0, sizeof (done));
+    if (writeBack != NULL) {
+        flushExpired();
+        for (uint8_t i = 0; i < amount; i++) {
+            uint8_t index = findWriteBack(items[i].id);
+            if (index < writeBackAmount) {
+                //the cached value is newer than EEPROM
+                done[i >> 3] |= 1 << (i & 7);
+                if (writeBack[index].size <= items[i].size) {
+                    touchWriteBack(index);
+                    memcpy(items[i].data, writeBackPool + writeBack[0].offset, writeBack[0].size);
+                    loaded++;
+                }
+            }
+        }
+    }
+
+    resumeDefrag();
+    if (useCache()) {
+        //the cache finds every item with a binary search
+        for (uint8_t i = 0; i < amount; i++) {
+            uint8_t index = findCached(items[i].id);
+            if (index < cachedAmount && !(done[i >> 3] & (1 << (i & 7)))
+                    && loadObject(cachedObjects[index], cachedAddresses[index], (uint8_t *) items[i].data, items[i].size)) {
+                loaded++;
+            }
+        }
+        return loaded;
+    }
+
+    //walk the directory once, instead of once per item
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+    uint16_t address = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (!(objects[i].flags & DEAD_FLAG)) {
+            for (uint8_t j = 0; j < amount; j++) {
+                if (items[j].id == objects[i].id && !(done[j >> 3] & (1 << (j & 7)))
+                        && loadObject(objects[i], address, (uint8_t *) items[j].data, items[j].size)) {
+                    loaded++;
+                }
+            }
+        }
+        address += objects[i].size;
+    }
+    return loaded;
+}
+
+EZPROM::Crc EZPROM::writeObject(uint16_t address, uint16_t size, const uint8_t* src, Serializable* serial) {
+    if (src != NULL) {
+        ramToEEPROM(address, src, size);
+        return updateCrc(CRC_START, src, size);
+    }
+    Writer writer(*this, address, size);
+    serial->serialize(writer);
+    writer.flush();
+    return writer.crc;
+}
+
+bool EZPROM::saveStream(uint8_t id, Serializable* serial) {
+    //load object data
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //check if id exists
+    uint8_t index = 0;
+    bool hasId = findIndex(objects, objectAmount, id, index);
+
+    //the size is only known once the object is written, so it is written
+    //behind the last object, into all the space that is left
+    uint16_t dataSize = getAddress(objects, objectAmount);
+    uint16_t used = dataSize + getDirectorySize(objects, objectAmount) + getEntrySize(MAX_OBJECT_SIZE);
+    uint16_t capacity = 0;
+    if (objectAmount < 255 && used <= getLength()) {
+        capacity = getLength() - used;
+    }
+    if (capacity > MAX_OBJECT_SIZE) {
+        capacity = MAX_OBJECT_SIZE;
+    }
+    Writer writer(*this, dataSize, capacity);
+    serial->serialize(writer);
+    writer.flush();
+    uint16_t size = writer.position();
+    if (writer.overflowed()) {
+        //the size is known now, so save it like an object of known size,
+        //which can resize the old version in place or reclaim holes
+        return size <= MAX_OBJECT_SIZE && saveObject(id, size, NULL, serial);
+    }
+
+    if (hasId) {
+        if (objects[index].size == size) {
+            //copy it over the old version, nothing else changes
+            moveBytes(dataSize, getAddress(objects, index), size);
+            if (getCrc(objects[index]) != writer.crc || objects[index].flags != 0) {
+                objects[index].flags = 0;
+                setCrc(objects[index], writer.crc);
+                saveEntry(objects, objectAmount, index);
+            }
+            return true;
+        } else if (!overwriteDiffSize) {
+            return false;
+        }
+    }
+
+    ObjectData updatedObjects[objectAmount + 1];
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        updatedObjects[i] = objects[i];
+    }
+    if (hasId) {
+        updatedObjects[index].flags = DEAD_FLAG;
+    }
+    updatedObjects[objectAmount].id = id;
+    updatedObjects[objectAmount].size = size;
+    updatedObjects[objectAmount].flags = 0;
+    setCrc(updatedObjects[objectAmount], writer.crc);
+    saveObjectData(updatedObjects, objectAmount + 1);
+    if (hasId && compactOnRemove) {
+        compact();
+    }
+    return true;
+}
+
+bool EZPROM::saveObject(uint8_t id, uint16_t size, const uint8_t* src, Serializable* serial, uint8_t flags) {
+    if (size > MAX_OBJECT_SIZE) {
+        return false;
+    }
+
+    //load object data
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //check if id exists
+    uint8_t index = 0;
+    bool hasId = findIndex(objects, objectAmount, id, index);
+
+    //sum of all object sizes, the end of the data region
+    uint16_t dataSize = getAddress(objects, objectAmount);
+    if (hasId) {
+        if (objects[index].size == size) {
+            //a 32 bit CRC is strong enough to tell an unchanged object apart
+            //without reading it back; narrower ones can miss changes
+            if (EZPROM_CRC_BITS == 32 && src != NULL && objects[index].flags == flags
+                    && getCrc(objects[index]) == updateCrc(CRC_START, src, size)) {
+                return true;
+            }
+            //overwrite object
+            Crc crc = writeObject(getAddress(objects, index), size, src, serial);
+            if (getCrc(objects[index]) != crc || objects[index].flags != flags) {
+                objects[index].flags = flags;
+                setCrc(objects[index], crc);
+                saveEntry(objects, objectAmount, index);
+            }
+            return true;
+        } else if (!overwriteDiffSize) {
+            return false;
+        } else if (compactOnRemove) {
+            //grow or shrink the object where it is, only the objects behind it move
+            uint16_t address = getAddress(objects, index);
+            if (resize(objects, objectAmount, index, size)) {
+                objects[index].flags = flags;
+                setCrc(objects[index], writeObject(address, size, src, serial));
+                saveEntry(objects, objectAmount, index);
+                return true;
+            }
+        }
+        //otherwise the old object becomes a hole when the new one is appended
+    }
+
+    //the smallest hole the object fits in takes it, so the end stays free
+    if (reuseHoles && (!hasId || !compactOnRemove)
+            && saveIntoHole(objects, objectAmount, hasId ? index : objectAmount, id, size, src, serial, flags, true)) {
+        return true;
+    }
+
+    bool hasSpace = false;
+    if (!hasId || !compactOnRemove) {
+        //calculate space totalSize
+        uint16_t totalSize = dataSize;
+        totalSize += getDirectorySize(objects, objectAmount) + getEntrySize(size); //add ObjectData array with the new object & length number
+        totalSize += size;
+        hasSpace = totalSize <= getLength() && objectAmount < 255;
+    }
+
+    //splitting a hole moves the directory entries behind it, which still beats compacting
+    if (!hasSpace && reuseHoles && (!hasId || !compactOnRemove)
+            && saveIntoHole(objects, objectAmount, hasId ? index : objectAmount, id, size, src, serial, flags, false)) {
+        return true;
+    }
+
+    if (!hasSpace) {
+        //see if reclaiming the holes left by removed objects makes enough space
+        uint16_t deadSize = hasId ? objects[index].size : 0;
+        uint8_t deadAmount = hasId ? 1 : 0;
+        uint16_t directorySize = getDirectorySize(objects, objectAmount) + getEntrySize(size);
+        if (hasId) {
+            directorySize -= getEntrySize(objects[index].size);
+        }
+        for (uint8_t i = 0; i < objectAmount; i++) {
+            if (objects[i].flags & DEAD_FLAG) {
+                deadSize += objects[i].size;
+                deadAmount++;
+                directorySize -= getEntrySize(objects[i].size);
+            }
+        }
+        if (deadAmount == (hasId ? 1 : 0)
+                || dataSize - deadSize + size + directorySize > getLength()) {
+            return false;
+        }
+        if (hasId && !compactOnRemove) {
+            remove(id);
+        }
+        compact();
+        return saveObject(id, size, src, serial, flags);
+    }
+
+    //on paged devices, a small object that would straddle two pages starts at
+    //the next page instead, behind a hole, so that saving it costs one write cycle
+    uint16_t padding = getPagePadding(dataSize, size);
+    if (padding > 0 && (objectAmount >= 254
+            || dataSize + padding + size + getDirectorySize(objects, objectAmount)
+            + getEntrySize(padding) + getEntrySize(size) > getLength())) {
+        padding = 0;
+    }
+
+    ObjectData updatedObjects[objectAmount + 2];
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        updatedObjects[i] = objects[i];
+    }
+    if (hasId) {
+        updatedObjects[index].flags = DEAD_FLAG;
+    }
+    uint8_t updatedAmount = objectAmount;
+    if (padding > 0) {
+        ObjectData hole;
+        hole.id = id;
+        hole.size = padding;
+        hole.flags = DEAD_FLAG;
+        setCrc(hole, CRC_START);
+        updatedObjects[updatedAmount++] = hole;
+    }
+    ObjectData thisObjectData;
+    thisObjectData.id = id;
+    thisObjectData.size = size;
+    thisObjectData.flags = flags;
+    //save, the new object goes right behind the last one
+    setCrc(thisObjectData, writeObject(dataSize + padding, size, src, serial));
+    updatedObjects[updatedAmount++] = thisObjectData;
+    saveObjectData(updatedObjects, updatedAmount);
+    return true;
+}
+
+bool EZPROM::appendBytes(uint8_t id, const uint8_t* src, uint16_t size) {
+    STATS_OPERATION();
+    syncWriteBack(id, true);
+    //load object data
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //check if id exists
+    uint8_t index = 0;
+    if (!findIndex(objects, objectAmount, id, index)) {
+        return saveBytes(id, src, size);
+    }
+    uint16_t oldSize = objects[index].size;
+    if (size > MAX_OBJECT_SIZE - oldSize || (objects[index].flags & COMPRESSED_FLAG)) {
+        return false;
+    }
+
+    uint16_t address = getAddress(objects, index);
+    uint16_t dataSize = getAddress(objects, objectAmount);
+    uint16_t tailSize = dataSize - address - oldSize;
+    if (!compactOnRemove && oldSize < tailSize && reuseHoles
+            && appendIntoHole(objects, objectAmount, index, src, size, true)) {
+        return true;
+    }
+    if (!compactOnRemove && oldSize < tailSize && objectAmount < 255
+            && dataSize + oldSize + size + getDirectorySize(objects, objectAmount)
+            + getEntrySize(oldSize + size) <= getLength()) {
+        //copying the object behind the last one moves fewer bytes than
+        //shifting everything behind it, and leaves a hole
+        ObjectData updatedObjects[objectAmount + 1];
+        for (uint8_t i = 0; i < objectAmount; i++) {
+            updatedObjects[i] = objects[i];
+        }
+        updatedObjects[index].flags = DEAD_FLAG;
+        updatedObjects[objectAmount] = objects[index];
+        updatedObjects[objectAmount].size = oldSize + size;
+        moveBytes(address, dataSize, oldSize);
+        ramToEEPROM(dataSize + oldSize, src, size);
+        setCrc(updatedObjects[objectAmount], updateCrc(getCrc(objects[index]), src, size));
+        saveObjectData(updatedObjects, objectAmount + 1);
+        return true;
+    }
+    if (!compactOnRemove && oldSize < tailSize && reuseHoles
+            && appendIntoHole(objects, objectAmount, index, src, size, false)) {
+        return true;
+    }
+
+    if (resize(objects, objectAmount, index, oldSize + size)) {
+        ramToEEPROM(address + oldSize, src, size);
+        setCrc(objects[index], updateCrc(getCrc(objects[index]), src, size));
+        saveEntry(objects, objectAmount, index);
+        return true;
+    }
+    //see if reclaiming the holes left by removed objects makes enough space
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (objects[i].flags & DEAD_FLAG) {
+            compact();
+            return appendBytes(id, src, size);
+        }
+    }
+    return false;
+}
+
+bool EZPROM::saveIntoHole(ObjectData* objects, uint8_t objectAmount, uint8_t oldIndex, uint8_t id, uint16_t size,
+        const uint8_t* src, Serializable* serial, uint8_t flags, bool stable) {
+    ObjectData object;
+    object.id = id;
+    object.size = size;
+    object.flags = flags;
+    ObjectData updatedObjects[objectAmount + 1];
+    uint8_t updatedAmount = 0;
+    uint8_t position = 0;
+    uint16_t address = 0;
+    if (!fillHole(objects, objectAmount, oldIndex, object, stable, updatedObjects, updatedAmount, position, address)) {
+        return false;
+    }
+    setCrc(updatedObjects[position], writeObject(address, size, src, serial));
+    saveObjectData(updatedObjects, updatedAmount);
+    return true;
+}
+
+bool EZPROM::appendIntoHole(ObjectData* objects, uint8_t objectAmount, uint8_t index,
+        const uint8_t* src, uint16_t size, bool stable) {
+    //the object is copied into the hole, then the new bytes are written behind it
+    ObjectData grown = objects[index];
+    grown.size += size;
+    ObjectData updatedObjects[objectAmount + 1];
+    uint8_t updatedAmount = 0;
+    uint8_t position = 0;
+    uint16_t address = 0;
+    if (!fillHole(objects, objectAmount, index, grown, stable, updatedObjects, updatedAmount, position, address)) {
+        return false;
+    }
+    moveBytes(getAddress(objects, index), address, objects[index].size);
+    ramToEEPROM(address + objects[index].size, src, size);
+    setCrc(updatedObjects[position], updateCrc(getCrc(objects[index]), src, size));
+    saveObjectData(updatedObjects, updatedAmount);
+    return true;
+}
+
+bool EZPROM::fillHole(ObjectData* objects, uint8_t objectAmount, uint8_t oldIndex, const ObjectData& object,
+        bool stable, ObjectData* updated, uint8_t& updatedAmount, uint8_t& position, uint16_t& address) {
+    if (object.size == 0) {
+        return false;
+    }
+    //find the smallest run of consecutive holes that is large enough. A run
+    //keeps its amount of entries: the object, a hole for the rest of the run,
+    //and empty holes. A single hole larger than the object is split in two
+    uint8_t first = objectAmount;
+    uint8_t last = 0;
+    uint16_t holeSize = 0;
+    for (uint8_t i = 0; i < objectAmount;) {
+        if (!(objects[i].flags & DEAD_FLAG)) {
+            i++;
+            continue;
+        }
+        uint8_t end = i;
+        uint16_t runSize = 0;
+        uint16_t entrySize = 0;
+        while (end < objectAmount && (objects[end].flags & DEAD_FLAG)) {
+            entrySize += getEntrySize(objects[end].size);
+            runSize += objects[end++].size;
+        }
+        if (runSize < object.size || (first < objectAmount && runSize >= holeSize)) {
+            i = end;
+            continue;
+        }
+        //with #stable, the entries behind the run must not move
+        uint8_t entries = end - i;
+        if (stable && (entries == 1 ? runSize > object.size : getEntrySize(object.size)
+                + getEntrySize(runSize - object.size) + (entries - 2) * getEntrySize(0) != entrySize)) {
+            i = end;
+            continue;
+        }
+        first = i;
+        last = end - 1;
+        holeSize = runSize;
+        i = end;
+    }
+    bool split = first == last && holeSize > object.size;
+    if (first == objectAmount || (split && objectAmount == 255)) {
+        return false;
+    }
+
+    //the run becomes the object and a hole for the rest of it, the entries
+    //left over become empty holes that #compact removes
+    updatedAmount = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (i == first) {
+            position = updatedAmount;
+            updated[updatedAmount++] = object;
+            ObjectData hole;
+            hole.id = object.id;
+            hole.size = holeSize - object.size;
+            hole.flags = DEAD_FLAG;
+            setCrc(hole, CRC_START);
+            for (uint8_t j = first + 1; j <= last || (split && j == first + 1); j++) {
+                updated[updatedAmount++] = hole;
+                hole.size = 0;
+            }
+            i = last;
+            continue;
+        }
+        updated[updatedAmount] = objects[i];
+        if (i == oldIndex) {
+            updated[updatedAmount].flags = DEAD_FLAG;
+        }
+        updatedAmount++;
+    }
+    //the data region keeps its size, but a split adds an entry to the directory
+    if (getAddress(objects, objectAmount) + getDirectorySize(updated, updatedAmount) > getLength()) {
+        return false;
+    }
+    address = getAddress(objects, first);
+    return true;
+}
+
+bool EZPROM::resize(ObjectData* objects, uint8_t objectAmount, uint8_t index, uint16_t size) {
+    uint16_t address = getAddress(objects, index);
+    uint16_t dataSize = getAddress(objects, objectAmount);
+    uint16_t oldEnd = address + objects[index].size;
+    if (size > objects[index].size) {
+        uint16_t growth = size - objects[index].size;
+        //a larger size can take a longer directory entry
+        uint16_t directorySize = getDirectorySize(objects, objectAmount)
+                - getEntrySize(objects[index].size) + getEntrySize(size);
+        if (dataSize + growth + directorySize > getLength()) {
+            return false;
+        }
+    }
+    moveBytes(oldEnd, address + size, dataSize - oldEnd);
+    objects[index].size = size;
+    saveObjectData(objects, objectAmount);
+    return true;
+}
+
+bool EZPROM::loadRangeBytes(uint8_t id, uint16_t offset, uint16_t length, uint8_t* dest) {
+    STATS_OPERATION();
+    uint8_t cached = findWriteBack(id);
+    if (cached < writeBackAmount) {
+        WriteBackEntry & entry = writeBack[cached];
+        if (offset > entry.size || length > entry.size - offset) {
+            return false;
+        }
+        memcpy(dest, writeBackPool + entry.offset + offset, length);
+        return true;
+    }
+    ObjectData object;
+    uint16_t address;
+    if (!lookup(id, object, address) || (object.flags & COMPRESSED_FLAG)
+            || offset > object.size || length > object.size - offset) {
+        return false;
+    }
+    readBlock(address + offset, dest, length);
+    return true;
+}
+
+bool EZPROM::saveRangeBytes(uint8_t id, uint16_t offset, const uint8_t* src, uint16_t length) {
+    STATS_OPERATION();
+    uint8_t cached = findWriteBack(id);
+    if (cached < writeBackAmount) {
+        WriteBackEntry & entry = writeBack[cached];
+        if (offset > entry.size || length > entry.size - offset) {
+            return false;
+        }
+        memcpy(writeBackPool + entry.offset + offset, src, length);
+        if (!entry.dirty) {
+            entry.dirty = true;
+            entry.dirtySince = millis();
+            writeBackDirty += entry.size;
+        }
+        enforceFlushBudget();
+        return true;
+    }
+    ObjectData object;
+    uint16_t address;
+    if (!lookup(id, object, address) || (object.flags & COMPRESSED_FLAG)
+            || offset > object.size || length > object.size - offset) {
+        return false;
+    }
+    ramToEEPROM(address + offset, src, length);
+#if EZPROM_CRC_BITS > 0
+    //the CRC covers the whole object, so rather than reading the object back
+    //on every write, it is marked stale once and updated later
+    if (!(object.flags & STALE_CRC_FLAG)) {
+        uint8_t objectAmount = getEntryAmount();
+        ObjectData objects[objectAmount];
+        loadObjectData(objects, objectAmount);
+        uint8_t index = 0;
+        findIndex(objects, objectAmount, id, index);
+        objects[index].flags |= STALE_CRC_FLAG;
+        saveEntry(objects, objectAmount, index);
+        staleCrcs = true;
+    }
+#endif
+    return true;
+}
+
+bool EZPROM::loadSerial(uint8_t id, Serializable* dest) {
+    STATS_OPERATION();
+    syncWriteBack(id, false);
+    ObjectData object;
+    uint16_t address;
+    if (lookup(id, object, address)) {
+        Reader reader(*this, address, object.size);
+        if (object.flags & COMPRESSED_FLAG) {
+            //the decompressor needs the whole object in RAM, and a corrupt
+            //size must not exhaust it
+            uint16_t size = EZLzss::getSize(reader);
+            if (size > MAX_OBJECT_SIZE || size > EZLzss::getMaxSize(object.size)) {
+                return false;
+            }
+            uint8_t * buffer = (uint8_t *) malloc(size);
+            if (buffer == NULL && size > 0) {
+                return false;
+            }
+            EZLzss::decompress(reader, buffer, size);
+            Reader decompressed(buffer, size);
+            bool loaded = loadSerial(decompressed, dest);
+            free(buffer);
+            return loaded;
+        }
+        return loadSerial(reader, dest);
+    }
+    return false;
+}
+
+bool EZPROM::loadSerial(Reader& reader, Serializable* dest) {
+    if (!dest->isBuffered()) {
+        dest->deserialize(reader);
+        return true;
+    }
+    uint16_t size = reader.available();
+    uint8_t * buffer = (uint8_t *) malloc(size);
+    if (buffer == NULL && size > 0) {
+        return false;
+    }
+    reader.read(buffer, size);
+    uint16_t index = 0;
+    static_cast<BufferSerializable *> (dest)->deserialize(buffer, index);
+    free(buffer);
+    return true;
+}
+
+bool EZPROM::exists(uint8_t id) {
+    if (useCache()) {
+        return cachedIds[id >> 3] & (1 << (id & 7));
+    }
+    ObjectData object;
+    uint16_t address;
+    return lookup(id, object, address);
+}
+
+uint16_t EZPROM::getAddress(uint8_t id) {
+    //the caller may read the object from EEPROM directly
+    syncWriteBack(id, false);
+    ObjectData object;
+    uint16_t address;
+    if (lookup(id, object, address)) {
+        return regionStart + address;
+    }
+    return storage->length();
+}
+
+bool EZPROM::lookup(uint8_t id, ObjectData& object, uint16_t& address) {
+    resumeDefrag();
+    if (useCache()) {
+        uint8_t index = findCached(id);
+        if (index < cachedAmount) {
+            object = cachedObjects[index];
+            address = cachedAddresses[index];
+            return isInRegion(address, object.size);
+        }
+        return false;
+    }
+
+    //walk the directory in EEPROM one entry at a time
+    address = 0;
+    uint8_t objectAmount = readEntryAmount();
+    STATS_ADD(directoryLoads, 1);
+    uint16_t cursor = getFirstEntry(objectAmount);
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        readEntry(cursor, object);
+        if (object.id == id && !(object.flags & DEAD_FLAG)) {
+            return isInRegion(address, object.size);
+        }
+        address += object.size;
+    }
+    return false;
+}
+
+bool EZPROM::isInRegion(uint16_t address, uint16_t size) {
+    //a corrupt directory can describe objects past the end of the region
+    return (uint32_t) address + size <= getLength();
+}
+
+bool EZPROM::findIndex(ObjectData* objects, uint8_t objectAmount, uint8_t id, uint8_t& index) {
+    if (cacheEnabled && cacheValid) {
+        index = findCached(id);
+        return index < cachedAmount;
+    }
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (objects[i].id == id && !(objects[i].flags & DEAD_FLAG)) {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+uint16_t EZPROM::getAddress(ObjectData* objects, uint8_t index) {
+    if (cacheEnabled && cacheValid) {
+        return cachedAddresses[index];
+    }
+    uint16_t address = 0;
+    for (uint8_t i = 0; i < index; i++) {
+        address += objects[i].size;
+    }
+    return address;
+}
+
+uint8_t EZPROM::getObjectAmount() {
+    if (useCache()) {
+        return cachedLive;
+    }
+    //removed objects waiting for #compact are not counted
+    uint8_t objectAmount = readEntryAmount();
+    STATS_ADD(directoryLoads, 1);
+    uint8_t liveAmount = 0;
+    uint16_t cursor = getFirstEntry(objectAmount);
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        ObjectData object;
+        readEntry(cursor, object);
+        if (!(object.flags & DEAD_FLAG)) {
+            liveAmount++;
+        }
+    }
+    return liveAmount;
+}
+
+uint8_t EZPROM::getEntryAmount() {
+    resumeDefrag();
+    if (useCache()) {
+        return cachedAmount;
+    }
+    return readEntryAmount();
+}
+
+uint8_t EZPROM::getEntrySize(uint16_t size) {
+#if EZPROM_COMPACT_DIRECTORY
+    //the id, the head byte, and the size bits that do not fit in the head
+    return 2 + getExtraSizeBytes(size) + EZPROM_CRC_BITS / 8;
+#else
+    (void) size;
+    return sizeof (StoredObjectData);
+#endif
+}
+
+uint16_t EZPROM::getDirectorySize(const ObjectData* objects, uint8_t objectAmount) {
+#if EZPROM_COMPACT_DIRECTORY
+    uint16_t size = DIRECTORY_TRAILER;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        size += getEntrySize(objects[i].size);
+    }
+    return size;
+#else
+    (void) objects;
+    return DIRECTORY_TRAILER + sizeof (StoredObjectData) * objectAmount;
+#endif
+}
+
+uint16_t EZPROM::getFirstEntry(uint8_t objectAmount) {
+#if EZPROM_COMPACT_DIRECTORY
+    //entries grow down from the trailer, so adding one does not move the others
+    (void) objectAmount;
+    return getLength() - DIRECTORY_TRAILER;
+#else
+    return getLength() - DIRECTORY_TRAILER - sizeof (StoredObjectData) * objectAmount;
+#endif
+}
+
+#if EZPROM_COMPACT_DIRECTORY
+
+uint8_t EZPROM::getExtraSizeBytes(uint16_t size) {
+    if (size < (1 << HEAD_SIZE_BITS)) {
+        return 0;
+    }
+    return size < (1 << (HEAD_SIZE_BITS + 8)) ? 1 : 2;
+}
+
+void EZPROM::readEntry(uint16_t& cursor, ObjectData& object) {
+    //the entry ends at the cursor with its head byte, laid out from the lowest
+    //address as: CRC, size bytes, id, head. Multi-byte fields are little endian
+    if (cursor < 2 || cursor > getLength()) {
+        readOutsideEntry(object);
+        return;
+    }
+    uint8_t entry[2];
+    readBlock(cursor - sizeof (entry), entry, sizeof (entry));
+    object.id = entry[0];
+    object.flags = entry[1] >> HEAD_FLAGS_SHIFT;
+    object.size = entry[1] & ((1 << HEAD_SIZE_BITS) - 1);
+    uint8_t extra = (entry[1] >> HEAD_EXTRA_SHIFT) & 0x03;
+    cursor -= sizeof (entry);
+    //the rest of the entry is read at once
+    uint8_t rest[2 + EZPROM_CRC_BITS / 8] = {};
+    uint8_t restSize = extra + EZPROM_CRC_BITS / 8;
+    if (restSize == 0) {
+        return;
+    }
+    if (restSize > sizeof (rest) || restSize > cursor) {
+        //only a corrupted directory gets here
+        restSize = 0;
+        extra = 0;
+    }
+    cursor -= restSize;
+    readBlock(cursor, rest, restSize);
+    for (uint8_t i = 0; i < extra; i++) {
+        object.size |= (uint16_t) rest[EZPROM_CRC_BITS / 8 + i] << (HEAD_SIZE_BITS + 8 * i);
+    }
+    object.size &= MAX_OBJECT_SIZE;
+#if EZPROM_CRC_BITS > 0
+    object.crc = 0;
+    for (uint8_t i = 0; i < EZPROM_CRC_BITS / 8; i++) {
+        object.crc |= (Crc) rest[i] << (8 * i);
+    }
+#endif
+}
+
+void EZPROM::writeEntry(uint16_t& cursor, const ObjectData& object) {
+    //see #readEntry
+    uint8_t extra = getExtraSizeBytes(object.size);
+    uint8_t entry[4 + EZPROM_CRC_BITS / 8];
+    uint8_t length = 0;
+#if EZPROM_CRC_BITS > 0
+    for (uint8_t i = 0; i < EZPROM_CRC_BITS / 8; i++) {
+        entry[length++] = object.crc >> (8 * i);
+    }
+#endif
+    for (uint8_t i = 0; i < extra; i++) {
+        entry[length++] = object.size >> (HEAD_SIZE_BITS + 8 * i);
+    }
+    entry[length++] = object.id;
+    entry[length++] = (object.flags << HEAD_FLAGS_SHIFT) | (extra << HEAD_EXTRA_SHIFT)
+            | (object.size & ((1 << HEAD_SIZE_BITS) - 1));
+    cursor -= length;
+    updateBlock(cursor, entry, length);
+}
+
+#else
+
+void EZPROM::readEntry(uint16_t& cursor, ObjectData& object) {
+    if ((uint32_t) cursor + sizeof (StoredObjectData) > getLength()) {
+        readOutsideEntry(object);
+        cursor += sizeof (StoredObjectData);
+        return;
+    }
+    StoredObjectData stored;
+    readObject(cursor, stored);
+    cursor += sizeof (StoredObjectData);
+    object.id = stored.id;
+    object.size = stored.size & MAX_OBJECT_SIZE;
+    object.flags = stored.size >> 13;
+#if EZPROM_CRC_BITS > 0
+    object.crc = stored.crc;
+#endif
+}
+
+void EZPROM::writeEntry(uint16_t& cursor, const ObjectData& object) {
+    StoredObjectData stored;
+    //clear the padding found on 32-bit targets, so it is not rewritten needlessly
+    memset(&stored, 0, sizeof (stored));
+    stored.id = object.id;
+    stored.size = object.size | ((uint16_t) object.flags << 13);
+#if EZPROM_CRC_BITS > 0
+    stored.crc = object.crc;
+#endif
+    updateObject(cursor, stored);
+    cursor += sizeof (StoredObjectData);
+}
+
+#endif
+
+void EZPROM::readOutsideEntry(ObjectData& object) {
+    //an erased or corrupted amount byte describes more entries than fit in
+    //the region; the ones outside of it read as empty holes
+    memset(&object, 0, sizeof (object));
+    object.flags = DEAD_FLAG;
+}
+
+uint8_t EZPROM::readEntryAmount() {
+    //read amount from last address on EEPROM
+    uint8_t objectAmt = 0;
+    readObject(getLength() - sizeof (uint8_t), objectAmt);
+    return objectAmt;
+}
+
+EZPROM::ObjectData EZPROM::getObjectData(uint8_t id) {
+    ObjectData object;
+    uint16_t address;
+    if (lookup(id, object, address)) {
+        return object;
+    }
+    ObjectData badObject;
+    badObject.id = id;
+    badObject.size = 0;
+    badObject.flags = 0;
+    setCrc(badObject, CRC_START);
+    return badObject;
+}
+
+bool EZPROM::verify(uint8_t id) {
+    syncWriteBack(id, false);
+    ObjectData object;
+    uint16_t address;
+    if (!lookup(id, object, address)) {
+        return false;
+    }
+    if (object.flags & STALE_CRC_FLAG) {
+        updateStaleCrcs();
+        return true;
+    }
+    return readCrc(address, object.size) == getCrc(object);
+}
+
+void EZPROM::updateStaleCrcs() {
+#if EZPROM_CRC_BITS > 0
+    if (!staleCrcs) {
+        return;
+    }
+    staleCrcs = false;
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+    uint16_t address = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if ((objects[i].flags & (DEAD_FLAG | STALE_CRC_FLAG)) == STALE_CRC_FLAG) {
+            objects[i].flags &= ~STALE_CRC_FLAG;
+            setCrc(objects[i], readCrc(address, objects[i].size));
+            saveEntry(objects, objectAmount, i);
+        }
+        address += objects[i].size;
+    }
+#endif
+}
+
+EZPROM::Crc EZPROM::updateCrc(Crc crc, const uint8_t* data, uint16_t size) {
+#if EZPROM_CRC_BITS == 32
+    return EZCrc::crc32(data, size, crc);
+#elif EZPROM_CRC_BITS == 16
+    return EZCrc::crc16(data, size, crc);
+#elif EZPROM_CRC_BITS == 8
+    return EZCrc::crc8(data, size, crc);
+#else
+    (void) data;
+    (void) size;
+    return crc;
+#endif
+}
+
+EZPROM::Crc EZPROM::readCrc(uint16_t address, uint16_t size) {
+    Crc crc = CRC_START;
+    uint8_t window[EZPROM_MOVE_WINDOW];
+    for (uint16_t done = 0; done < size;) {
+        uint16_t chunk = size - done < EZPROM_MOVE_WINDOW ? size - done : EZPROM_MOVE_WINDOW;
+        readBlock(address + done, window, chunk);
+        crc = updateCrc(crc, window, chunk);
+        done += chunk;
+    }
+    return crc;
+}
+
+EZPROM::Crc EZPROM::getCrc(const ObjectData& object) {
+#if EZPROM_CRC_BITS > 0
+    return object.crc;
+#else
+    (void) object;
+    return CRC_START;
+#endif
+}
+
+void EZPROM::setCrc(ObjectData& object, Crc crc) {
+#if EZPROM_CRC_BITS > 0
+    object.crc = crc;
+#else
+    (void) object;
+    (void) crc;
+#endif
+}
+
+void EZPROM::saveEntry(ObjectData* objects, uint8_t objectAmount, uint8_t index) {
+    if (cacheEnabled && cacheValid) {
+        cachedObjects[index] = objects[index];
+        if (batchDepth > 0) {
+            directoryDirty = true;
+            return;
+        }
+    }
+    uint16_t cursor = getFirstEntry(objectAmount);
+#if EZPROM_COMPACT_DIRECTORY
+    for (uint8_t i = 0; i < index; i++) {
+        cursor -= getEntrySize(objects[i].size);
+    }
+#else
+    cursor += index * sizeof (StoredObjectData);
+#endif
+    writeEntry(cursor, objects[index]);
+}
+
+void EZPROM::remove(uint8_t id) {
+    STATS_OPERATION();
+    uint8_t cached = findWriteBack(id);
+    if (cached < writeBackAmount) {
+        dropWriteBack(cached);
+    }
+    //load object data
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //check if id exists
+    uint8_t index = 0;
+    bool hasId = findIndex(objects, objectAmount, id, index);
+
+    if (hasId) {
+        objects[index].flags = DEAD_FLAG;
+        if (compactOnRemove) {
+            compact(objects, objectAmount);
+        } else if (index == objectAmount - 1) {
+            //nothing to shift behind the last object, so no hole is needed
+            saveObjectData(objects, objectAmount - 1);
+        } else {
+            //leave a hole, only the flag byte of the entry changes in EEPROM
+            saveObjectData(objects, objectAmount);
+        }
+    }
+}
+
+uint8_t EZPROM::removeMany(const uint8_t* ids, uint8_t amount) {
+    uint8_t mask[32] = {};
+    for (uint8_t i = 0; i < amount; i++) {
+        mask[ids[i] >> 3] |= 1 << (ids[i] & 7);
+    }
+    return removeIds(mask);
+}
+
+uint8_t EZPROM::removeBetween(uint8_t firstId, uint8_t lastId) {
+    uint8_t mask[32] = {};
+    for (uint16_t id = firstId; id <= lastId; id++) {
+        mask[id >> 3] |= 1 << (id & 7);
+    }
+    return removeIds(mask);
+}
+
+uint8_t EZPROM::removeIds(const uint8_t* ids) {
+    STATS_OPERATION();
+    for (uint8_t i = 0; i < writeBackAmount;) {
+        if (ids[writeBack[i].id >> 3] & (1 << (writeBack[i].id & 7))) {
+            dropWriteBack(i);
+        } else {
+            i++;
+        }
+    }
+    //load object data
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //mark every object as removed first, so the directory is written once
+    uint8_t removed = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        if (!(objects[i].flags & DEAD_FLAG) && (ids[objects[i].id >> 3] & (1 << (objects[i].id & 7)))) {
+            objects[i].flags = DEAD_FLAG;
+            removed++;
+        }
+    }
+    if (removed == 0) {
+        return 0;
+    }
+    if (compactOnRemove) {
+        compact(objects, objectAmount);
+        return removed;
+    }
+    //nothing to shift behind the last objects, so no holes are needed there
+    while (objectAmount > 0 && (objects[objectAmount - 1].flags & DEAD_FLAG)) {
+        objectAmount--;
+    }
+    saveObjectData(objects, objectAmount);
+    return removed;
+}
+
+void EZPROM::compact() {
+    STATS_OPERATION();
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+    compact(objects, objectAmount);
+}
+
+void EZPROM::compact(ObjectData* objects, uint8_t objectAmount) {
+    //objects in front of the first hole stay where they are
+    uint8_t first = 0;
+    while (first < objectAmount && !(objects[first].flags & DEAD_FLAG)) {
+        first++;
+    }
+    if (first == objectAmount) {
+        return;
+    }
+
+    //shift every object behind the first hole down, in a single pass; runs of
+    //live objects between two holes are moved as one block
+    uint16_t newAddress = getAddress(objects, first);
+    uint16_t oldAddress = newAddress;
+    uint16_t runSize = 0;
+    uint8_t liveAmount = first;
+    for (uint8_t i = first; i < objectAmount; i++) {
+        if (objects[i].flags & DEAD_FLAG) {
+            moveBytes(oldAddress, newAddress, runSize);
+            newAddress += runSize;
+            oldAddress += runSize + objects[i].size;
+            runSize = 0;
+        } else {
+            runSize += objects[i].size;
+            objects[liveAmount++] = objects[i];
+        }
+    }
+    moveBytes(oldAddress, newAddress, runSize);
+    saveObjectData(objects, liveAmount);
+}
+
+bool EZPROM::tick(uint16_t maxBytes) {
+    STATS_OPERATION();
+    if (batchDepth > 0) {
+        //a loop calling tick until it returns false must not spin through the batch
+        return false;
+    }
+    //an object left half moved is moved on, not finished at once
+    defragMoving = false;
+    return defragStep(maxBytes, false);
+}
+
+bool EZPROM::defragStep(uint16_t maxBytes, bool resumeOnly) {
+    uint8_t objectAmount = getEntryAmount();
+    ObjectData objects[objectAmount];
+    loadObjectData(objects, objectAmount);
+
+    //the object to move is the first one behind a hole
+    uint8_t first = 0;
+    while (first < objectAmount && !(objects[first].flags & DEAD_FLAG)) {
+        first++;
+    }
+    //the journal is kept in the flags of the first hole
+    bool journaled = first < objectAmount && (objects[first].flags & JOURNAL_FLAG);
+    if (resumeOnly && !journaled) {
+        return false;
+    }
+    uint8_t index = first;
+    uint16_t holeSize = 0;
+    while (index < objectAmount && (objects[index].flags & DEAD_FLAG)) {
+        holeSize += objects[index++].size;
+    }
+    if (index == objectAmount) {
+        //only holes are left behind the last object, the directory drops them
+        if (first < objectAmount) {
+            saveObjectData(objects, first);
+        }
+        return false;
+    }
+
+    ObjectData object = objects[index];
+    uint16_t from = getAddress(objects, index);
+    uint16_t to = from - holeSize;
+    //the progress is kept in the free space behind the last object
+    uint16_t journal = getAddress(objects, objectAmount);
+    uint16_t done = 0;
+    uint8_t progress[2];
+    if (journaled) {
+        readBlock(journal, progress, sizeof (progress));
+        done = progress[0] | (uint16_t) progress[1] << 8;
+        if (done > object.size) {
+            //only a corrupted journal gets here
+            done = 0;
+        }
+    } else if (object.size > holeSize || object.size > maxBytes) {
+        //the move takes more than one call, or overwrites the object as it
+        //goes, so its progress must survive a reset
+        if (journal + sizeof (progress) + getDirectorySize(objects, objectAmount) > getLength()) {
+            compact(objects, objectAmount);
+            return false;
+        }
+        progress[0] = progress[1] = 0;
+        ramToEEPROM(journal, progress, sizeof (progress));
+        //the first hole carries the journal; a hole has no other flags
+        objects[first].flags = DEAD_FLAG | JOURNAL_FLAG;
+        saveEntry(objects, objectAmount, first);
+        journaled = true;
+    }
+
+    if (holeSize == 0) {
+        done = object.size;
+    }
+    for (uint16_t moved = 0; done < object.size && moved < maxBytes;) {
+        uint16_t chunk = object.size - done;
+        if (chunk > maxBytes - moved) {
+            chunk = maxBytes - moved;
+        }
+        //a chunk no larger than the hole never overwrites bytes not copied yet,
+        //so after a reset, the chunk after the journaled progress can be copied again
+        if (chunk > holeSize) {
+            chunk = holeSize;
+        }
+        moveBytes(from + done, to + done, chunk);
+        done += chunk;
+        moved += chunk;
+        if (journaled) {
+            progress[0] = done;
+            progress[1] = done >> 8;
+            ramToEEPROM(journal, progress, sizeof (progress));
+        }
+    }
+    if (done < object.size) {
+        defragMoving = true;
+        return true;
+    }
+
+    //the object trades entries with the first hole, the holes behind it can
+    //be in any order. The directory is rewritten with update, so with legacy
+    //entries only the two entries change; compact entries of different sizes
+    //also move the entries between them
+    objects[index] = objects[first];
+    objects[index].flags &= ~JOURNAL_FLAG;
+    objects[first] = object;
+    saveObjectData(objects, objectAmount);
+    return true;
+}
+
+void EZPROM::resumeDefrag() {
+    if (!defragMoving) {
+        return;
+    }
+    defragMoving = false;
+    //the directory is walked without loading it first, in case EEPROM holds
+    //garbage, which must not be taken for a journal
+    uint8_t objectAmount = readEntryAmount();
+    uint16_t cursor = getFirstEntry(objectAmount);
+    bool journaled = false;
+    uint32_t dataSize = 0;
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        ObjectData object;
+        readEntry(cursor, object);
+        dataSize += object.size;
+        if ((object.flags & (DEAD_FLAG | COMPRESSED_FLAG | JOURNAL_FLAG)) == (DEAD_FLAG | JOURNAL_FLAG)) {
+            journaled = true;
+        }
+    }
+    if (journaled && dataSize <= getLength()) {
+        defragStep(MAX_OBJECT_SIZE, true);
+    }
+}
+
+void EZPROM::setCompactOnRemove(bool b) {
+    compactOnRemove = b;
+}
+
+void EZPROM::setReuseHoles(bool b) {
+    reuseHoles = b;
+}
+
+void EZPROM::setCompression(bool b) {
+    compression = b;
+}
+
+bool EZPROM::isCompressionEnabled() {
+    return compression;
+}
+
+void EZPROM::setOverwriteIfSizeDifferent(bool b) {
+    overwriteDiffSize = b;
+}
+
+void EZPROM::saveObjectData(ObjectData* objectData, uint8_t objectAmount) {
+    //keep the cache coherent with what is written
+    if (cacheEnabled) {
+        if (reserveCache(objectAmount)) {
+            memcpy(cachedObjects, objectData, sizeof (ObjectData) * objectAmount);
+            cachedAmount = objectAmount;
+            updateCacheIndex();
+            cacheValid = true;
+            if (batchDepth > 0) {
+                //written once by #commitBatch
+                directoryDirty = true;
+                return;
+            }
+        } else {
+            disableCache();
+        }
+    }
+    writeObjectData(objectData, objectAmount);
+}
+
+void EZPROM::writeObjectData(ObjectData* objectData, uint8_t objectAmount) {
+    //save object data
+    uint16_t cursor = getFirstEntry(objectAmount);
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        writeEntry(cursor, objectData[i]);
+    }
+    //save length of array
+    updateObject(getLength() - sizeof (uint8_t), objectAmount);
+    directoryDirty = false;
+}
+
+void EZPROM::ramToEEPROM(uint16_t address, const uint8_t* ram, uint16_t size) {
+    updateBlock(address, ram, size);
+}
+
+void EZPROM::readBlock(uint16_t address, uint8_t* ram, uint16_t size) {
+    storage->read(regionStart + address, ram, size);
+    STATS_ADD(reads, size);
+}
+
+void EZPROM::updateBlock(uint16_t address, const uint8_t* ram, uint16_t size) {
+    uint16_t written = storage->update(regionStart + address, ram, size);
+    STATS_ADD(writes, written);
+    STATS_ADD(skippedWrites, size - written);
+}
+
+uint16_t EZPROM::getPagePadding(uint16_t address, uint16_t size) {
+    if (!(storage->getCapabilities() & EZStorage::PAGED)) {
+        return 0;
+    }
+    uint16_t pageSize = storage->getPageSize();
+    uint16_t offset = (regionStart + address) % pageSize;
+    if (size > pageSize || offset + size <= pageSize) {
+        return 0;
+    }
+    return pageSize - offset;
+}
+
+uint16_t EZPROM::getMoveChunk(uint16_t end, uint16_t left, bool down) {
+    uint16_t chunk = left < EZPROM_MOVE_WINDOW ? left : EZPROM_MOVE_WINDOW;
+    if (storage->getCapabilities() & EZStorage::PAGED) {
+        //keep every chunk within one destination page, so each costs at most one write cycle
+        uint16_t pageSize = storage->getPageSize();
+        uint16_t offset = (regionStart + end) % pageSize;
+        uint16_t pageLeft = down ? pageSize - offset : (offset == 0 ? pageSize : offset);
+        if (chunk > pageLeft) {
+            chunk = pageLeft;
+        }
+    }
+    return chunk;
+}
+
+void EZPROM::moveBytes(uint16_t from, uint16_t to, uint16_t size) {
+    if (from == to || size == 0) {
+        return;
+    }
+    STATS_ADD(compactionBytes, size);
+    uint8_t window[EZPROM_MOVE_WINDOW];
+    if (to < from) {
+        //moving down, copy front to back so the source is read before it is overwritten
+        for (uint16_t done = 0; done < size;) {
+            uint16_t chunk = getMoveChunk(to + done, size - done, true);
+            readBlock(from + done, window, chunk);
+            updateBlock(to + done, window, chunk);
+            done += chunk;
+        }
+    } else {
+        //moving up, copy back to front
+        for (uint16_t left = size; left > 0;) {
+            uint16_t chunk = getMoveChunk(to + left, left, false);
+            left -= chunk;
+            readBlock(from + left, window, chunk);
+            updateBlock(to + left, window, chunk);
+        }
+    }
+}
+
+void EZPROM::loadObjectData(ObjectData* objectData, uint8_t objectAmount) {
+    if (cacheEnabled && cacheValid) {
+        memcpy(objectData, cachedObjects, sizeof (ObjectData) * objectAmount);
+        return;
+    }
+    //load all objects
+    STATS_ADD(directoryLoads, 1);
+    uint16_t cursor = getFirstEntry(objectAmount);
+    for (uint8_t i = 0; i < objectAmount; i++) {
+        readEntry(cursor, objectData[i]);
+    }
+}
+
+
+bool EZPROM::beginBatch() {
+    if (batchDepth == 0 && !cacheEnabled) {
+        //the batch needs the directory in RAM
+        batchCache = true;
+        if (!enableCache()) {
+            batchCache = false;
+            return false;
+        }
+    }
+    batchDepth++;
+    return true;
+}
+
+void EZPROM::commitBatch() {
+    if (batchDepth == 0 || --batchDepth > 0) {
+        return;
+    }
+    if (directoryDirty) {
+        writeObjectData(cachedObjects, cachedAmount);
+    }
+    if (batchCache) {
+        batchCache = false;
+        disableCache();
+    }
+}
+
+void EZPROM::setRegion(uint16_t start, uint16_t length) {
+    //the cached values belong to the old region
+    flush();
+    while (writeBackAmount > 0) {
+        dropWriteBack(0);
+    }
+    regionStart = start;
+    regionLength = length;
+    defragMoving = true;
+    staleCrcs = true;
+    invalidateCache();
+}
+
+uint32_t EZPROM::getRequiredLength(uint8_t objectAmount, uint16_t objectSize) {
+    return (uint32_t) objectAmount * (objectSize + getEntrySize(objectSize)) + DIRECTORY_TRAILER;
+}
+
+uint16_t EZPROM::getLength() {
+    if (regionLength == 0) {
+        return storage->length() - regionStart;
+    }
+    return regionLength;
+}
+
+bool EZPROM::enableCache() {
+    cacheEnabled = true;
+    return refreshCache();
+}
+
+void EZPROM::disableCache() {
+    if (directoryDirty) {
+        writeObjectData(cachedObjects, cachedAmount);
+    }
+    free(cachedObjects);
+    free(cachedAddresses);
+    free(cachedOrder);
+    cachedObjects = NULL;
+    cachedAddresses = NULL;
+    cachedOrder = NULL;
+    cacheCapacity = 0;
+    cachedAmount = 0;
+    cacheValid = false;
+    cacheEnabled = false;
+}
+
+bool EZPROM::isCacheEnabled() {
+    return cacheEnabled;
+}
+
+void EZPROM::invalidateCache() {
+    //the cache holds the only copy of a directory changed by a batch
+    if (!directoryDirty) {
+        cacheValid = false;
+    }
+    //values that were not changed since they were loaded may be stale now
+    for (uint8_t i = writeBackAmount; i > 0; i--) {
+        if (!writeBack[i - 1].dirty) {
+            dropWriteBack(i - 1);
+        }
+    }
+}
+
+bool EZPROM::refreshCache() {
+    if (!cacheEnabled) {
+        return false;
+    }
+    if (directoryDirty) {
+        return true;
+    }
+    uint8_t objectAmount = readEntryAmount();
+    if (!reserveCache(objectAmount)) {
+        disableCache();
+        return false;
+    }
+    cacheValid = false;
+    //cache is invalid, so this reads from EEPROM
+    loadObjectData(cachedObjects, objectAmount);
+    cachedAmount = objectAmount;
+    updateCacheIndex();
+    cacheValid = true;
+    return true;
+}
+
+bool EZPROM::reserveCache(uint8_t objectAmount) {
+    if (objectAmount <= cacheCapacity && cachedAddresses != NULL) {
+        return true;
+    }
+    //grow in steps of 8 so appending objects rarely reallocates
+    uint16_t capacity = (objectAmount + 8) & ~7;
+    if (capacity > 255) {
+        capacity = 255;
+    }
+    ObjectData * grown = (ObjectData *) realloc(cachedObjects, sizeof (ObjectData) * capacity);
+    if (grown == NULL) {
+        return false;
+    }
+    cachedObjects = grown;
+    uint8_t * grownOrder = (uint8_t *) realloc(cachedOrder, capacity);
+    if (grownOrder == NULL) {
+        return false;
+    }
+    cachedOrder = grownOrder;
+    uint16_t * grownAddresses = (uint16_t *) realloc(cachedAddresses, sizeof (uint16_t) * (capacity + 1));
+    if (grownAddresses == NULL) {
+        return false;
+    }
+    cachedAddresses = grownAddresses;
+    cacheCapacity = capacity;
+    return true;
+}
+
+void EZPROM::updateCacheIndex() {
+    uint16_t address = 0;
+    memset(cachedIds, 0, sizeof (cachedIds));
+    cachedLive = 0;
+    for (uint8_t i = 0; i < cachedAmount; i++) {
+        cachedAddresses[i] = address;
+        address += cachedObjects[i].size;
+        if (cachedObjects[i].flags & DEAD_FLAG) {
+            continue;
+        }
+        uint8_t id = cachedObjects[i].id;
+        cachedIds[id >> 3] |= 1 << (id & 7);
+
+        //insertion sort, linear when ids are saved in ascending order
+        uint8_t j = cachedLive++;
+        while (j > 0 && cachedObjects[cachedOrder[j - 1]].id > id) {
+            cachedOrder[j] = cachedOrder[j - 1];
+            j--;
+        }
+        cachedOrder[j] = i;
+    }
+    cachedAddresses[cachedAmount] = address;
+}
+
+uint8_t EZPROM::findCached(uint8_t id) {
+    if (!(cachedIds[id >> 3] & (1 << (id & 7)))) {
+        return cachedAmount;
+    }
+    uint8_t low = 0;
+    uint8_t high = cachedLive;
+    while (low < high) {
+        uint8_t middle = low + ((high - low) >> 1);
+        uint8_t index = cachedOrder[middle];
+        if (cachedObjects[index].id == id) {
+            return index;
+        } else if (cachedObjects[index].id < id) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return cachedAmount;
+}
+
+bool EZPROM::enableWriteBack(uint8_t entries, uint16_t bytes) {
+    disableWriteBack();
+    writeBack = (WriteBackEntry *) malloc(sizeof (WriteBackEntry) * entries);
+    writeBackPool = (uint8_t *) malloc(bytes);
+    if (entries == 0 || writeBack == NULL || writeBackPool == NULL) {
+        disableWriteBack();
+        return false;
+    }
+    writeBackCapacity = entries;
+    writeBackPoolSize = bytes;
+    return true;
+}
+
+void EZPROM::disableWriteBack() {
+    //the destructor gets here too, when the storage may be gone already
+    if (writeBack == NULL) {
+        return;
+    }
+    flush();
+    free(writeBack);
+    free(writeBackPool);
+    writeBack = NULL;
+    writeBackPool = NULL;
+    writeBackCapacity = 0;
+    writeBackAmount = 0;
+    writeBackPoolSize = 0;
+    writeBackUsed = 0;
+    writeBackDirty = 0;
+}
+
+bool EZPROM::flush() {
+    STATS_OPERATION();
+    bool flushed = true;
+    for (uint8_t i = 0; i < writeBackAmount; i++) {
+        if (!flushWriteBack(i)) {
+            flushed = false;
+        }
+    }
+    updateStaleCrcs();
+    return flushed;
+}
+
+void EZPROM::flushExpired() {
+    if (flushDeadline == 0 || writeBackDirty == 0) {
+        return;
+    }
+    uint32_t now = millis();
+    for (uint8_t i = 0; i < writeBackAmount; i++) {
+        if (writeBack[i].dirty && now - writeBack[i].dirtySince >= flushDeadline) {
+            flushWriteBack(i);
+        }
+    }
+}
+
+void EZPROM::setFlushDeadline(uint32_t deadline) {
+    flushDeadline = deadline;
+}
+
+void EZPROM::setFlushBudget(uint16_t bytes) {
+    flushBudget = bytes;
+    enforceFlushBudget();
+}
+
+#if EZPROM_STATS
+
+EZPROM::Stats EZPROM::getStats() {
+    return stats;
+}
+
+void EZPROM::resetStats() {
+    memset(&stats, 0, sizeof (stats));
+}
+
+void EZPROM::printStats(Print& out) {
+    out.print("reads=");
+    out.print((unsigned long) stats.reads);
+    out.print(" writes=");
+    out.print((unsigned long) stats.writes);
+    out.print(" skipped=");
+    out.print((unsigned long) stats.skippedWrites);
+    out.print(" loads=");
+    out.print((unsigned long) stats.directoryLoads);
+    out.print(" compaction=");
+    out.print((unsigned long) stats.compactionBytes);
+    out.print(" last=");
+    out.print((unsigned long) stats.lastMicros);
+    out.print("us max=");
+    out.print((unsigned long) stats.maxMicros);
+    out.println("us");
+}
+
+size_t EZPROM::writeStats(Print& out) {
+    const uint32_t counters[] = {stats.reads, stats.writes, stats.skippedWrites, stats.directoryLoads,
+        stats.compactionBytes, stats.lastMicros, stats.maxMicros};
+    const uint8_t amount = sizeof (counters) / sizeof (counters[0]);
+    uint8_t record[1 + amount * 4];
+    record[0] = amount;
+    for (uint8_t i = 0; i < amount; i++) {
+        for (uint8_t j = 0; j < 4; j++) {
+            record[1 + i * 4 + j] = counters[i] >> (8 * j);
+        }
+    }
+    return out.write(record, sizeof (record));
+}
+
+EZPROM::Operation::Operation(EZPROM& ezprom) : ezprom(ezprom) {
+    if (ezprom.operationDepth++ == 0) {
+        ezprom.operationStart = micros();
+    }
+}
+
+EZPROM::Operation::~Operation() {
+    if (--ezprom.operationDepth == 0) {
+        uint32_t duration = micros() - ezprom.operationStart;
+        ezprom.stats.lastMicros = duration;
+        if (duration > ezprom.stats.maxMicros) {
+            ezprom.stats.maxMicros = duration;
+        }
+    }
+}
+
+#endif
+
+uint8_t EZPROM::findWriteBack(uint8_t id) {
+    for (uint8_t i = 0; i < writeBackAmount; i++) {
+        if (writeBack[i].id == id) {
+            return i;
+        }
+    }
+    return writeBackAmount;
+}
+
+void EZPROM::touchWriteBack(uint8_t index) {
+    WriteBackEntry entry = writeBack[index];
+    memmove(writeBack + 1, writeBack, sizeof (WriteBackEntry) * index);
+    writeBack[0] = entry;
+}
+
+bool EZPROM::addWriteBack(uint8_t id, uint16_t size, bool evict) {
+    if (size > writeBackPoolSize) {
+        return false;
+    }
+    while (writeBackAmount == writeBackCapacity || size > writeBackPoolSize - writeBackUsed) {
+        if (!evict) {
+            return false;
+        }
+        flushWriteBack(writeBackAmount - 1);
+        dropWriteBack(writeBackAmount - 1);
+    }
+    memmove(writeBack + 1, writeBack, sizeof (WriteBackEntry) * writeBackAmount);
+    writeBackAmount++;
+    writeBack[0].id = id;
+    writeBack[0].dirty = false;
+    writeBack[0].size = size;
+    writeBack[0].offset = writeBackUsed;
+    writeBackUsed += size;
+    return true;
+}
+
+void EZPROM::dropWriteBack(uint8_t index) {
+    WriteBackEntry entry = writeBack[index];
+    if (entry.dirty) {
+        writeBackDirty -= entry.size;
+    }
+    //close the gap in the pool
+    memmove(writeBackPool + entry.offset, writeBackPool + entry.offset + entry.size,
+            writeBackUsed - entry.offset - entry.size);
+    writeBackUsed -= entry.size;
+    writeBackAmount--;
+    memmove(writeBack + index, writeBack + index + 1, sizeof (WriteBackEntry) * (writeBackAmount - index));
+    for (uint8_t i = 0; i < writeBackAmount; i++) {
+        if (writeBack[i].offset > entry.offset) {
+            writeBack[i].offset -= entry.size;
+        }
+    }
+}
+
+bool EZPROM::flushWriteBack(uint8_t index) {
+    WriteBackEntry & entry = writeBack[index];
+    if (!entry.dirty) {
+        return true;
+    }
+    entry.dirty = false;
+    writeBackDirty -= entry.size;
+    return saveObject(entry.id, entry.size, writeBackPool + entry.offset, NULL);
+}
+
+bool EZPROM::saveWriteBack(uint8_t id, const uint8_t* src, uint16_t size) {
+    flushExpired();
+    uint8_t index = findWriteBack(id);
+    if (index < writeBackAmount) {
+        if (writeBack[index].size != size) {
+            //resizing changes the directory, so it is written through; the
+            //old value is written first in case the new one does not fit
+            syncWriteBack(id, true);
+            return false;
+        }
+        touchWriteBack(index);
+        if (memcmp(writeBackPool + writeBack[0].offset, src, size) == 0) {
+            return true;
+        }
+    } else {
+        //only objects already stored with this size are cached, so the
+        //directory in EEPROM is always up to date
+        ObjectData object;
+        uint16_t address;
+        if (!lookup(id, object, address) || object.size != size || (object.flags & COMPRESSED_FLAG)
+                || !addWriteBack(id, size, true)) {
+            return false;
+        }
+    }
+    WriteBackEntry & entry = writeBack[0];
+    memcpy(writeBackPool + entry.offset, src, size);
+    if (!entry.dirty) {
+        entry.dirty = true;
+        entry.dirtySince = millis();
+        writeBackDirty += size;
+    }
+    enforceFlushBudget();
+    return true;
+}
+
+void EZPROM::syncWriteBack(uint8_t id, bool forget) {
+    uint8_t index = findWriteBack(id);
+    if (index < writeBackAmount) {
+        flushWriteBack(index);
+        if (forget) {
+            dropWriteBack(index);
+        }
+    }
+}
+
+void EZPROM::enforceFlushBudget() {
+    for (uint8_t i = writeBackAmount; i > 0 && writeBackDirty > flushBudget; i--) {
+        flushWriteBack(i - 1);
+    }
+}
+
+bool EZPROM::useCache() {
+    if (!cacheEnabled) {
+        return false;
+    }
+    return cacheValid || refreshCache();
+}
+
+EZPROM::Writer::Writer(uint8_t* buffer, uint16_t capacity)
+: ezprom(NULL), buffer(buffer), address(0), capacity(capacity), crc(CRC_START) {
+}
+
+EZPROM::Writer::Writer(EZPROM& ezprom, uint16_t address, uint16_t capacity)
+: ezprom(&ezprom), buffer(NULL), address(address), capacity(capacity), crc(CRC_START) {
+}
+
+void EZPROM::Writer::write(const uint8_t* data, uint16_t size) {
+    for (uint16_t i = 0; i < size; i++) {
+        if (index >= capacity) {
+            //keep counting, so the size of the whole object is known
+            overflow = true;
+            if (index < 0xFFFF) {
+                index++;
+            }
+            continue;
+        }
+        if (buffer != NULL) {
+            buffer[index++] = data[i];
+            continue;
+        }
+        window[pending++] = data[i];
+        index++;
+        if (pending == EZPROM_MOVE_WINDOW) {
+            flush();
+        }
+    }
+}
+
+void EZPROM::Writer::flush() {
+    if (pending > 0) {
+        uint16_t end = index < capacity ? index : capacity;
+        crc = updateCrc(crc, window, pending);
+        ezprom->updateBlock(address + end - pending, window, pending);
+        pending = 0;
+    }
+}
+
+void EZPROM::Writer::putSerial(Serializable& src) {
+    src.serialize(*this);
+}
+
+uint16_t EZPROM::Writer::position() {
+    return index;
+}
+
+bool EZPROM::Writer::overflowed() {
+    return overflow;
+}
+
+EZPROM::Reader::Reader(const uint8_t* buffer, uint16_t size)
+: ezprom(NULL), buffer(buffer), address(0), size(size) {
+}
+
+EZPROM::Reader::Reader(EZPROM& ezprom, uint16_t address, uint16_t size)
+: ezprom(&ezprom), buffer(NULL), address(address), size(size) {
+}
+
+void EZPROM::Reader::read(uint8_t* data, uint16_t length) {
+    for (uint16_t i = 0; i < length; i++) {
+        if (index == size) {
+            data[i] = 0;
+            continue;
+        }
+        if (buffer != NULL) {
+            data[i] = buffer[index++];
+            continue;
+        }
+        if (index >= windowStart + windowLength) {
+            //refill the window with the next bytes of the object
+            windowStart = index;
+            windowLength = size - index < EZPROM_MOVE_WINDOW ? size - index : EZPROM_MOVE_WINDOW;
+            ezprom->readBlock(address + windowStart, window, windowLength);
+        }
+        data[i] = window[index++ - windowStart];
+    }
+}
+
+void EZPROM::Reader::getSerial(Serializable& dest) {
+    dest.deserialize(*this);
+}
+
+void EZPROM::BufferSerializable::serialize(Writer& writer) {
+    uint16_t length = size();
+    uint8_t * stream = (uint8_t *) malloc(length);
+    if (stream == NULL) {
+        return;
+    }
+    uint16_t index = 0;
+    serialize(stream, index);
+    writer.write(stream, length);
+    free(stream);
+}
+
+void EZPROM::BufferSerializable::deserialize(Reader& reader) {
+    uint16_t length = size();
+    if (length == 0 || length > reader.available()) {
+        length = reader.available();
+    }
+    uint8_t * stream = (uint8_t *) malloc(length);
+    if (stream == NULL) {
+        return;
+    }
+    reader.read(stream, length);
+    uint16_t index = 0;
+    deserialize(stream, index);
+    free(stream);
+}
+
+uint16_t EZPROM::Reader::available() {
+    return size - index;
+}
@@ -2,21 +2,55 @@
 #define EZPROM_H
 
 #include <Arduino.h>
-#include <EEPROM.h>
+#include "EZStorage.h"
+#include "EZCrc.h"
 
 //the last ID in EZPROM belongs to the unique int, used for verifying that EEPROM
 //is setup, see #isValid and #reset(uint16_t)
 //note: DO NOT OVERWRITE THIS ID
 #define UNIQUE_INT_ID 255
 
+//the size of the RAM buffer used when objects are shifted, see EZPROM#compact
+#ifndef EZPROM_MOVE_WINDOW
+#if defined(__AVR__)
+#define EZPROM_MOVE_WINDOW 16
+#else
+#define EZPROM_MOVE_WINDOW 64
+#endif
+#endif
+
+//the width of the CRC stored with every object in the directory: 0 (none), 8,
+//16 or 32 bits, see EZPROM#verify. With 32 bits, saving an unchanged object
+//returns once the CRCs match, without reading the object; 8 and 16 bits are
+//too short to rule out a collision, so the object is compared byte by byte.
+//Changing it changes the directory format, so EEPROM must be reset afterwards
+#ifndef EZPROM_CRC_BITS
+#define EZPROM_CRC_BITS 0
+#endif
+
+//1 stores the directory in a compact format that is the same on every
+//architecture: 2 bytes per object of up to 7 bytes, 3 up to 2047 bytes and 4
+//above, plus the CRC. Changing it changes the directory format, see
+//EZPROM#migrateDirectory
+#ifndef EZPROM_COMPACT_DIRECTORY
+#define EZPROM_COMPACT_DIRECTORY 0
+#endif
+
+//1 counts the bytes EZPROM reads, writes and moves, and times its calls, see
+//EZPROM#getStats. 0 removes the counters and the code that updates them
+#ifndef EZPROM_STATS
+#define EZPROM_STATS 1
+#endif
+
 /**
  * EZPROM allows for easy manipulation of EEPROM memory. It allows for objects
  * to be stored to and retrieved from EEPROM with an ID number instead of an address.
  * Any type of object can be stored, including pointers and multidimensional arrays.
  * 
  * Each objects ID number and size are saved into EEPROM as well as the object.
- * This adds an additional 3 bytes into EEPROM with each object saved. This means
- * an array of objects will be less costly to save compared to individual objects. 
+ * This adds an additional 3 bytes into EEPROM with each object saved, or 2 for
+ * small objects with EZPROM_COMPACT_DIRECTORY. This means an array of objects
+ * will be less costly to save compared to individual objects. 
  * 
  * Each saved object can be overwritten in size. For example, if a char[32] is
  * saved at some point and a char[64] is saved into the same ID at a later pointer,
@@ -27,19 +61,375 @@
  * by EZPROM.
  */
 class EZPROM {
+public:
+    // the CRC kept with every object, see EZPROM_CRC_BITS
+#if EZPROM_CRC_BITS == 32
+    typedef uint32_t Crc;
+#elif EZPROM_CRC_BITS == 16
+    typedef uint16_t Crc;
+#else
+    typedef uint8_t Crc;
+#endif
+
+    /**
+     * Stores the id and size of objects stored into EEPROM.
+     */
+    struct ObjectData {
+        uint8_t id;
+        uint16_t size;
+        // see DEAD_FLAG
+        uint8_t flags;
+#if EZPROM_CRC_BITS > 0
+        // the CRC of the object, see EZPROM_CRC_BITS
+        Crc crc;
+#endif
+    };
+
+    /**
+     * The largest object that can be saved. The top 3 bits of the size stored
+     * in EEPROM are used for #ObjectData#flags.
+     */
+    static const uint16_t MAX_OBJECT_SIZE = 0x1FFF;
+
+    /**
+     * Set in #ObjectData#flags of a removed object whose space has not been
+     * reclaimed yet, see #setCompactOnRemove. The flags of the object it was
+     * are cleared.
+     */
+    static const uint8_t DEAD_FLAG = 0x04;
+
+    /**
+     * Set in #ObjectData#flags of an object stored compressed, see
+     * #setCompression. Its size is the compressed size.
+     */
+    static const uint8_t COMPRESSED_FLAG = 0x02;
+
+    /**
+     * Set in #ObjectData#flags, together with #DEAD_FLAG, of the hole in
+     * front of an object that #tick is moving.
+     */
+    static const uint8_t JOURNAL_FLAG = 0x01;
+
+    /**
+     * Set in #ObjectData#flags of an object written by #saveRange since its
+     * CRC was last updated, see #verify. Only holes have #JOURNAL_FLAG, so
+     * live objects use the same bit.
+     */
+    static const uint8_t STALE_CRC_FLAG = 0x01;
+
+#if EZPROM_STATS
+    /**
+     * What EZPROM did to the storage since it was created or #resetStats was
+     * called, see #getStats. The counters wrap around.
+     */
+    struct Stats {
+        // bytes read from the storage
+        uint32_t reads;
+        // bytes written to the storage
+        uint32_t writes;
+        // bytes not written because the storage held them already
+        uint32_t skippedWrites;
+        // times the directory was read from the storage, not from the cache
+        uint32_t directoryLoads;
+        // bytes of objects moved by #compact, #tick and size changes
+        uint32_t compactionBytes;
+        // the duration of the last and of the longest call, in micros()
+        uint32_t lastMicros;
+        uint32_t maxMicros;
+    };
+#endif
+
 private:
+    // the memory holding the objects, see #EZPROM(EZStorage &)
+    EZStorage * storage;
 	// see #setOverwriteIfSizeDifferent
     bool overwriteDiffSize = true;
+    // see #setCompactOnRemove
+    bool compactOnRemove = true;
+    // see #setReuseHoles
+    bool reuseHoles = false;
+    // true if #tick may have left an object half moved, see #resumeDefrag
+    bool defragMoving = true;
+    // true if an object may have #STALE_CRC_FLAG set, see #updateStaleCrcs
+    bool staleCrcs = true;
+    // see #setCompression
+    bool compression = false;
+    // see #setRegion
+    uint16_t regionStart = 0;
+    uint16_t regionLength = 0;
+    // see #enableCache
+    bool cacheEnabled = false;
+    // true while cachedObjects mirrors the directory in EEPROM
+    bool cacheValid = false;
+    uint8_t cachedAmount = 0;
+    uint8_t cacheCapacity = 0;
+    ObjectData * cachedObjects = NULL;
+    // start address of every cached object, plus the end of the data region
+    uint16_t * cachedAddresses = NULL;
+    // indexes into cachedObjects, sorted by id
+    uint8_t * cachedOrder = NULL;
+    // the amount of cached objects that are not dead, the length of cachedOrder
+    uint8_t cachedLive = 0;
+    // bit n is set if the object with id n is cached
+    uint8_t cachedIds[32] = {};
+    // see #beginBatch
+    uint8_t batchDepth = 0;
+    // true if the cache was enabled by #beginBatch
+    bool batchCache = false;
+    // true if the cached directory has changes not yet written to EEPROM
+    bool directoryDirty = false;
+
+    // an object held in RAM by the write-back cache, see #enableWriteBack
+    struct WriteBackEntry {
+        uint8_t id;
+        // true if the value in RAM was not written to EEPROM yet
+        bool dirty;
+        uint16_t size;
+        // where the value starts in writeBackPool
+        uint16_t offset;
+        // millis() when the entry became dirty
+        uint32_t dirtySince;
+    };
+    // the cached objects, from the most to the least recently used
+    WriteBackEntry * writeBack = NULL;
+    uint8_t writeBackCapacity = 0;
+    uint8_t writeBackAmount = 0;
+    // the values of the cached objects, packed one after another
+    uint8_t * writeBackPool = NULL;
+    uint16_t writeBackPoolSize = 0;
+    uint16_t writeBackUsed = 0;
+    // the total size of the dirty entries
+    uint16_t writeBackDirty = 0;
+    // see #setFlushDeadline
+    uint32_t flushDeadline = 0;
+    // see #setFlushBudget
+    uint16_t flushBudget = 0xFFFF;
+#if EZPROM_STATS
+    // see #getStats
+    Stats stats = {};
+    // the amount of nested calls being timed, and micros() when the outermost started
+    uint8_t operationDepth = 0;
+    uint32_t operationStart = 0;
+#endif
+
+    // not implemented: a copy would free the cache and write-back buffers twice
+    EZPROM(const EZPROM &);
+    EZPROM & operator=(const EZPROM &);
 public:
 
+    /**
+     * Creates an EZPROM that stores its objects in the internal EEPROM.
+     */
+    EZPROM();
+
+    /**
+     * Creates an EZPROM that stores its objects in @storage, for example an
+     * external EEPROM or a RAM buffer, see #EZStorage.
+     * @param storage the backend holding the objects; it must outlive the EZPROM
+     */
+    EZPROM(EZStorage & storage);
+
+    /**
+     * Writes the dirty values of the write-back cache, see #enableWriteBack,
+     * and commits a batch that is still open, see #beginBatch.
+     */
+    ~EZPROM();
+
+    class Serializable;
+
+    /**
+     * Writes a serialized object to its place in EEPROM a few bytes at a time,
+     * through a RAM window of EZPROM_MOVE_WINDOW bytes, so that saving a large
+     * object does not need a buffer the size of the object. Passed to
+     * Serializable#serialize by #saveSerial.
+     */
+    class Writer {
+    public:
+        /**
+         * Creates a writer that fills a buffer in RAM instead of EEPROM.
+         * Bytes past @capacity are dropped, see #overflowed.
+         * @param buffer the buffer
+         * @param capacity the size of the buffer
+         */
+        Writer(uint8_t * buffer, uint16_t capacity);
+
+        /**
+         * Writes an object to the stream.
+         * @param src the object to be written
+         */
+        template<typename T> void putObject(const T & src) {
+            write((const uint8_t *) & src, sizeof (T));
+        }
+
+        /**
+         * Writes @size bytes from @data to the stream.
+         */
+        void write(const uint8_t * data, uint16_t size);
+
+        /**
+         * Writes a nested Serializable to the stream.
+         */
+        void putSerial(Serializable & src);
+
+        /**
+         * @return the amount of bytes written so far, including dropped ones
+         */
+        uint16_t position();
+
+        /**
+         * @return true if more bytes were written than there is space for;
+         * the extra bytes were dropped
+         */
+        bool overflowed();
+
+    private:
+        friend class EZPROM;
+
+        Writer(EZPROM & ezprom, uint16_t address, uint16_t capacity);
+
+        // writes the bytes waiting in the window to EEPROM
+        void flush();
+
+        EZPROM * ezprom;
+        uint8_t * buffer;
+        uint16_t address;
+        uint16_t capacity;
+        uint16_t index = 0;
+        bool overflow = false;
+        uint8_t window[EZPROM_MOVE_WINDOW];
+        uint8_t pending = 0;
+        // the CRC of the bytes flushed so far
+        Crc crc;
+    };
+
+    /**
+     * Reads a serialized object from EEPROM a few bytes at a time, see
+     * #Writer. Passed to Serializable#deserialize by #loadSerial.
+     */
+    class Reader {
+    public:
+        /**
+         * Creates a reader over a buffer in RAM instead of EEPROM.
+         * @param buffer the buffer holding the serialized object
+         * @param size the size of the serialized object
+         */
+        Reader(const uint8_t * buffer, uint16_t size);
+
+        /**
+         * Reads an object from the stream. Bytes past the end of the stream
+         * read as 0.
+         * @param dest the object to which the retrieved value will be written into
+         */
+        template<typename T> void getObject(T & dest) {
+            read((uint8_t *) & dest, sizeof (T));
+        }
+
+        /**
+         * Reads @size bytes from the stream into @data.
+         */
+        void read(uint8_t * data, uint16_t size);
+
+        /**
+         * Reads a nested Serializable from the stream.
+         */
+        void getSerial(Serializable & dest);
+
+        /**
+         * @return the amount of bytes left in the stream
+         */
+        uint16_t available();
+
+    private:
+        friend class EZPROM;
+
+        Reader(EZPROM & ezprom, uint16_t address, uint16_t size);
+
+        EZPROM * ezprom;
+        const uint8_t * buffer;
+        uint16_t address;
+        uint16_t size;
+        uint16_t index = 0;
+        uint8_t window[EZPROM_MOVE_WINDOW];
+        // the stream index of window[0] and the amount of bytes in the window
+        uint16_t windowStart = 0;
+        uint8_t windowLength = 0;
+    };
+
     /**
      * This abstract class can be extended to provide serialization functionality,
      * allowing more control over how derived classes are saved into and retrieved
-     * from EEPROM. The deriving class must implement #serialize, #deserialize,
-     * and #size. To save to EEPROM, one can use EZPROM::saveSerial and to load,
+     * from EEPROM. To save to EEPROM, one can use EZPROM::saveSerial and to load,
      * one can use EEPROM::loadSerial.
+     * 
+     * The deriving class must implement #serialize and #deserialize, which
+     * stream the object directly to and from EEPROM through a #Writer and a
+     * #Reader:
+     * virtual void serialize(EZPROM::Writer & writer) {
+     *     writer.putObject(count);
+     *     writer.write(data, count);
+     * }
+     * virtual void deserialize(EZPROM::Reader & reader) {
+     *     reader.getObject(count);
+     *     reader.read(data, count);
+     * }
+     * Classes written for the byte stream versions derive from
+     * #BufferSerializable instead.
+     * 
+     * #size should be implemented too. If the size is not known before the
+     * object is serialized, it can return 0; the object is then written
+     * behind the last object in EEPROM and its size taken from the #Writer.
+     * If it does not fit there, it is serialized a second time once its
+     * size is known, so #serialize must write the same bytes every time.
      */
     class Serializable {
+    public:
+
+        virtual ~Serializable() {
+        }
+
+        /**
+         * Called by #saveSerial when saving a Serializable class to EEPROM.
+         * @param writer the stream to write the contents of the class to with
+         * Writer#putObject or Writer#write
+         */
+        virtual void serialize(Writer & writer) = 0;
+
+        /**
+         * Called by #loadSerial when loading a Serializable class from EEPROM.
+         * @param reader the stream to read the contents of the class from with
+         * Reader#getObject or Reader#read
+         */
+        virtual void deserialize(Reader & reader) = 0;
+
+        /**
+         * Called by #saveSerial to determine the size of the byte stream necessary
+         * to hold the contents of the Serializable class.
+         * @return the size of the Serializable class in bytes, or 0 if it is
+         * only known once the class is serialized
+         */
+        virtual uint16_t size() {
+            return 0;
+        }
+
+    private:
+        friend class EZPROM;
+
+        // true for a #BufferSerializable, which #saveSerial and #loadSerial
+        // hand a buffer of the whole object
+        virtual bool isBuffered() {
+            return false;
+        }
+    };
+
+    /**
+     * A Serializable saved through a byte stream the size of the object,
+     * for classes written before #Writer and #Reader existed. The deriving
+     * class must implement #serialize, #deserialize and #size. The byte
+     * stream is allocated on the heap while the object is saved or loaded;
+     * #saveSerial and #loadSerial return false if there is not enough RAM
+     * for it.
+     */
+    class BufferSerializable : public Serializable {
     public:
         /**
          * Called by #saveSerial when saving a Serializable class to EEPROM.
@@ -50,6 +440,7 @@ public:
          * passed to #putObject calls and calls to other #serialize methods
          */
         virtual void serialize(uint8_t * stream, uint16_t & index) = 0;
+
         /**
          * Called by #loadSerial when loading a Serializable class from EEPROM.
          * @param stream the byte stream used for retrieving data; it's size was 
@@ -59,6 +450,7 @@ public:
          * #getObject and #deserialize where it is incremented appropriately.
          */
         virtual void deserialize(uint8_t * stream, uint16_t & index) = 0;
+
         /**
          * Called by #saveSerial to determine the size of the byte stream necessary
          * to hold the contents of the Serializable class.
@@ -66,6 +458,20 @@ public:
          */
         virtual uint16_t size() = 0;
 
+        /**
+         * Serializes the class into a byte stream on the heap and writes it
+         * to @writer, when the class is nested in another Serializable.
+         * Nothing is written if there is not enough RAM for the byte stream.
+         */
+        virtual void serialize(Writer & writer);
+
+        /**
+         * Reads the class into a byte stream on the heap and deserializes it,
+         * when the class is nested in another Serializable. The class is left
+         * unchanged if there is not enough RAM for the byte stream.
+         */
+        virtual void deserialize(Reader & reader);
+
         /**
          * Writes an object into the byte stream, incrementing the index appropriately.
          * @param object the object to be written to the stream
@@ -95,6 +501,12 @@ public:
                 ram[i] = stream[index++];
             }
         }
+
+    private:
+
+        bool isBuffered() {
+            return true;
+        }
     };
 
     /**
@@ -114,6 +526,19 @@ public:
      */
     bool setup(uint16_t uniqueInt, uint8_t id = UNIQUE_INT_ID);
 
+    /**
+     * Converts a directory written without EZPROM_COMPACT_DIRECTORY to the
+     * compact format, keeping every object where it is. Does nothing if the
+     * directory is compact already or EZPROM_COMPACT_DIRECTORY is not set.
+     * #setup calls it first, so devices updated to a build with the compact
+     * directory keep their objects. EZPROM_CRC_BITS must not change at the
+     * same time, and a reset during the migration loses the directory.
+     * @return true if the directory is compact now, false if it did not look
+     * like a directory in either format, or if the compact one would not fit;
+     * EEPROM should be reset then
+     */
+    bool migrateDirectory();
+
     /**
      * Checks if the unique int is set to @uniqueInt. EZPROM is considered valid if the
      * correct @uniqueInt is set, otherwise it is invalid and should be reset prior to
@@ -132,14 +557,6 @@ public:
      */
     void setUniqueId(uint16_t uniqueInt, uint8_t id = UNIQUE_INT_ID);
 
-    /**
-     * Stores the id and size of objects stored into EEPROM.
-     */
-    struct ObjectData {
-        uint8_t id;
-        uint16_t size;
-    };
-
     /**
      * Stores an object and assigns it the given ID. Any object is stored as follows:
      * int i = 5;
@@ -162,82 +579,27 @@ public:
      */
     template<typename T>
     bool save(uint8_t id, const T& src, uint16_t elements = 1) {
-        //load object data
-        uint8_t objectAmount = getObjectAmount();
-        ObjectData objects[objectAmount];
-        loadObjectData(objects, objectAmount);
-
-        //check if id exists
-        uint8_t index = 0;
-        bool hasId = false;
-        bool hasSpace = false;
-        for (uint8_t i = 0; i < objectAmount; i++) {
-            if (objects[i].id == id) {
-                index = i;
-                hasId = true;
-                break;
-            }
-        }
-
-        if (hasId) {
-            if (objects[index].size == sizeof (T) * elements) {
-                //overwrite object
-                ramToEEPROM(getAddress(objects, index), src, objects[index].size);
-                return true;
-            } else if (overwriteDiffSize) {
-                //calculate space totalSize
-                uint16_t totalSize = 0;
-                for (uint8_t i = 0; i < objectAmount; i++) { //add all objects
-                    if (i != index) {
-                        totalSize += objects[i].size;
-                    }
-                }
-                totalSize += sizeof (uint8_t) + sizeof (ObjectData) * objectAmount; //add ObjectData array & length number
-                totalSize += sizeof (T) * elements;
-                if (totalSize <= EEPROM.length()) {
-                    hasSpace = true;
-                    remove(id);
-                    //update objects array
-                    for (uint8_t i = index; i < objectAmount - 1; i++) {
-                        objects[i] = objects[i + 1];
-                    }
-                    objectAmount--;
-                } else {
-                    return false;
-                }
-            } else {
-                return false;
-            }
-        }
-
-        if (!hasSpace) {
-            //calculate space totalSize
-            uint16_t totalSize = 0;
-            for (uint8_t i = 0; i < objectAmount; i++) { //add all objects
-                totalSize += objects[i].size;
-            }
-            totalSize += sizeof (uint8_t) + sizeof (ObjectData) * objectAmount; //add ObjectData array & length number
-            totalSize += sizeof (T) * elements + sizeof (ObjectData); //add new object with its ObjectData
-            hasSpace = totalSize <= EEPROM.length();
-        }
+        return saveBytes(id, (const uint8_t *) & src, sizeof (T) * elements);
+    }
 
-        if (hasSpace) {
-            ObjectData updatedObjects[objectAmount + 1];
-            for (uint8_t i = 0; i < objectAmount; i++) {
-                updatedObjects[i] = objects[i];
-            }
-            index = objectAmount;
-            ObjectData thisObjectData;
-            thisObjectData.id = id;
-            thisObjectData.size = sizeof (T) * elements;
-            updatedObjects[index] = thisObjectData;
-            //save
-            ramToEEPROM(getAddress(updatedObjects, index), src, updatedObjects[index].size);
-            saveObjectData(updatedObjects, objectAmount + 1);
-            return true;
-        } else {
-            return false;
-        }
+    /**
+     * Appends an object to the end of the object with the given ID, growing
+     * it. Only the objects behind it are shifted, or, if #setCompactOnRemove
+     * is false and that is cheaper, the object is copied behind the last one
+     * and its old space left as a hole. If the ID does not exist, this works
+     * like #save. For example, to keep a growing log of characters:
+     * char line[] = "boot\n";
+     * ezprom.append(log_id, *line, strlen(line));
+     * 
+     * @param id The ID of the object to be extended.
+     * @param src The object to be appended.
+     * @param elements The number of elements if the object is an array.
+     * @return True if the append was successful, false if there was no space on
+     * EEPROM.
+     */
+    template<typename T>
+    bool append(uint8_t id, const T& src, uint16_t elements = 1) {
+        return appendBytes(id, (const uint8_t *) & src, sizeof (T) * elements);
     }
 
     /**
@@ -258,31 +620,180 @@ public:
      * @return True if the object was retrieved, false if the ID does not exist.
      */
     template<typename T> bool load(uint8_t id, T& dest) {
-        //load object data
-        uint8_t objectAmount = getObjectAmount();
-        ObjectData objects[objectAmount];
-        loadObjectData(objects, objectAmount);
-
-        //check if id exists
-        uint8_t index = 0;
-        bool hasId = false;
-        for (uint8_t i = 0; i < objectAmount; i++) {
-            if (objects[i].id == id) {
-                index = i;
-                hasId = true;
-                break;
-            }
+        return loadBytes(id, (uint8_t *) & dest);
+    }
+
+    /**
+     * Loads part of the object with the specified ID, without reading the rest
+     * of it. For example, to load the third message of a char[6][32]:
+     * char msg[32];
+     * ezprom.loadRange(msgs_id, 2 * sizeof (msg), sizeof (msg), *msg);
+     * 
+     * @param id The ID of the object to be read.
+     * @param offset The first byte of the object to be read.
+     * @param length The amount of bytes to be read.
+     * @param dest The object which will hold the retrieved bytes.
+     * @return True if the bytes were retrieved, false if the ID does not exist
+     * or the range does not fit in the object.
+     */
+    template<typename T> bool loadRange(uint8_t id, uint16_t offset, uint16_t length, T& dest) {
+        return loadRangeBytes(id, offset, length, (uint8_t *) & dest);
+    }
+
+    /**
+     * Overwrites part of the object with the specified ID, without writing the
+     * rest of it. The size of the object does not change. For example, to
+     * replace the third message of a char[6][32]:
+     * char msg[32] = "Door open";
+     * ezprom.saveRange(msgs_id, 2 * sizeof (msg), *msg, sizeof (msg));
+     * 
+     * @param id The ID of the object to be written.
+     * @param offset The first byte of the object to be written.
+     * @param src The bytes to be written.
+     * With EZPROM_CRC_BITS set, the CRC of the object is not updated, so that
+     * writing a range costs no more than the range itself. The object is
+     * marked with #STALE_CRC_FLAG instead, which writes a byte of the directory
+     * the first time, and its CRC is updated by #flush, #verify or the next
+     * #save.
+     * 
+     * @param length The amount of bytes to be written, the size of @src by default.
+     * @return True if the bytes were written, false if the ID does not exist
+     * or the range does not fit in the object.
+     */
+    template<typename T> bool saveRange(uint8_t id, uint16_t offset, const T& src, uint16_t length = sizeof (T)) {
+        return saveRangeBytes(id, offset, (const uint8_t *) & src, length);
+    }
+
+    /**
+     * Reads and writes one element of an object saved as an array of T, see
+     * #view. Converts to T by loading the element and saves the element when
+     * assigned. Elements that are arrays themselves, such as the char[32]
+     * messages of a char[6][32], are copied with #load and #save instead.
+     */
+    template<typename T> class ElementBase {
+    public:
+
+        /**
+         * Loads the element into @dest.
+         * @return true if the element was loaded, false if it does not exist
+         */
+        bool load(T & dest) const {
+            return ezprom->loadRange(id, offset, sizeof (T), dest);
         }
 
-        if (hasId) {
-            uint16_t address = getAddress(objects, index);
-            uint8_t * ram = (uint8_t *) & dest;
-            for (uint16_t i = 0; i < objects[index].size; i++) {
-                ram[i] = EEPROM.read(address + i);
+        /**
+         * Saves @src over the element.
+         * @return true if the element was saved, false if it does not exist
+         */
+        bool save(const T & src) {
+            return ezprom->saveRange(id, offset, src, sizeof (T));
+        }
+
+    protected:
+
+        ElementBase(EZPROM & ezprom, uint8_t id, uint16_t offset)
+        : ezprom(&ezprom), id(id), offset(offset) {
+        }
+
+        // copies the element of @other over this one
+        void copy(const ElementBase & other) {
+            uint8_t value[sizeof (T)];
+            if (other.ezprom->loadRange(other.id, other.offset, sizeof (T), *value)) {
+                ezprom->saveRange(id, offset, *value, sizeof (T));
             }
-            return true;
         }
-        return false;
+
+    private:
+        EZPROM * ezprom;
+        uint8_t id;
+        uint16_t offset;
+    };
+
+    template<typename T> class Element : public ElementBase<T> {
+    public:
+
+        Element(EZPROM & ezprom, uint8_t id, uint16_t offset) : ElementBase<T>(ezprom, id, offset) {
+        }
+
+        operator T() const {
+            T value = T();
+            this->load(value);
+            return value;
+        }
+
+        Element & operator=(const T & src) {
+            this->save(src);
+            return *this;
+        }
+
+        Element & operator=(const Element & other) {
+            this->copy(other);
+            return *this;
+        }
+    };
+
+    template<typename T, size_t N> class Element<T[N]> : public ElementBase<T[N]> {
+    public:
+
+        Element(EZPROM & ezprom, uint8_t id, uint16_t offset) : ElementBase<T[N]>(ezprom, id, offset) {
+        }
+
+        Element & operator=(const T (&src)[N]) {
+            this->save(src);
+            return *this;
+        }
+
+        Element & operator=(const Element & other) {
+            this->copy(other);
+            return *this;
+        }
+    };
+
+    /**
+     * A lazy view of an object saved as an array of T, see #view.
+     */
+    template<typename T> class View {
+    public:
+
+        View(EZPROM & ezprom, uint8_t id) : ezprom(&ezprom), id(id) {
+        }
+
+        /**
+         * @return the element at @index, which is only read or written when
+         * it is used
+         */
+        Element<T> operator[](uint16_t index) {
+            return Element<T>(*ezprom, id, index * sizeof (T));
+        }
+
+        /**
+         * @return the amount of elements in the object, 0 if it does not exist
+         */
+        uint16_t size() {
+            return ezprom->getObjectData(id).size / sizeof (T);
+        }
+
+    private:
+        EZPROM * ezprom;
+        uint8_t id;
+    };
+
+    /**
+     * Creates a view of the object with the specified ID as an array of T.
+     * Reading an element of the view loads only that element, and assigning
+     * to it saves only that element, so an element of a large array can be
+     * updated without loading and saving the whole array:
+     * EZPROM::View<int> counts = ezprom.view<int>(counts_id);
+     * counts[3] = counts[3] + 1;
+     * 
+     * The object is looked up on every access, which is fast with
+     * #enableCache. Elements past the end of the object are not written and
+     * read as T().
+     * @param id The ID of the object, saved as an array of T.
+     * @return A view of the object.
+     */
+    template<typename T> View<T> view(uint8_t id) {
+        return View<T>(*this, id);
     }
 
     bool saveSerial(uint8_t id, const Serializable * src);
@@ -295,6 +806,153 @@ public:
      */
     void remove(uint8_t id);
 
+    /**
+     * An object saved or loaded by #saveMany and #loadMany, see #item.
+     */
+    struct Item {
+        uint8_t id;
+        // the object in RAM
+        void * data;
+        // the size of the object, the most bytes loaded into it
+        uint16_t size;
+    };
+
+    /**
+     * Creates an #Item for @src, as it would be passed to #save:
+     * EZPROM::Item settings[] = {
+     *     EZPROM::item(port_id, port),
+     *     EZPROM::item(pwd_id, *pwd, sizeof (pwd))
+     * };
+     * @param elements The number of elements if the object is an array.
+     */
+    template<typename T> static Item item(uint8_t id, T & src, uint16_t elements = 1) {
+        Item result = {id, (void *) & src, (uint16_t) (sizeof (T) * elements)};
+        return result;
+    }
+
+    /**
+     * Saves several objects, like #save, while reading and writing the
+     * directory once instead of once per object: the saves are made in a
+     * batch, see #beginBatch. An object that does not fit does not keep the
+     * others from being saved.
+     * @param items the objects to be saved
+     * @param amount the amount of @items
+     * @return true if every object was saved
+     */
+    bool saveMany(const Item * items, uint8_t amount);
+
+    /**
+     * Loads several objects, like #load, while reading the directory once
+     * instead of once per object; with #enableCache, every object is found
+     * with a binary search of the cache. An object larger than the size of its #Item
+     * is not loaded, and the #Item of an ID that does not exist is left
+     * untouched, so defaults can be set beforehand:
+     * ezprom.loadMany(settings, sizeof (settings) / sizeof (settings[0]));
+     * @param items the objects to be loaded
+     * @param amount the amount of @items
+     * @return the amount of objects loaded
+     */
+    uint8_t loadMany(Item * items, uint8_t amount);
+
+    /**
+     * Removes several objects, like #remove, while reading and writing the
+     * directory once instead of once per object. If #setCompactOnRemove is
+     * true, the space of all of them is reclaimed by a single #compact.
+     * @param ids the IDs of the objects to be removed
+     * @param amount the amount of @ids
+     * @return the amount of objects removed
+     */
+    uint8_t removeMany(const uint8_t * ids, uint8_t amount);
+
+    /**
+     * Removes every object whose ID lies between @firstId and @lastId, see
+     * #removeMany. The range includes both, and UNIQUE_INT_ID if @lastId is
+     * 255.
+     * @return the amount of objects removed
+     */
+    uint8_t removeBetween(uint8_t firstId, uint8_t lastId);
+
+    /**
+     * Specifies if #remove reclaims the space of the removed object right
+     * away. If true, which is the default, every object behind the removed one
+     * is shifted down, which can take a long time on a full EEPROM. If false,
+     * #remove only marks the object as removed, which rewrites a single byte
+     * of its #ObjectData, and leaves a hole that is reclaimed later by #compact.
+     * Objects saved with a different size than before are then appended
+     * without shifting anything either.
+     * 
+     * Holes still take up space until they are reused, see #setReuseHoles,
+     * or reclaimed by #compact or by any #remove made while this is true.
+     * @param b whether #remove reclaims space right away
+     */
+    void setCompactOnRemove(bool b);
+
+    /**
+     * Specifies if new objects, and objects saved or appended to with a
+     * different size, are placed into the holes left by removed objects
+     * before EEPROM is compacted. If false, a #save that does not fit behind
+     * the last object calls #compact automatically. If true, an object goes
+     * into the smallest run of adjacent holes it fits in, and the rest of the
+     * run stays a hole; it is appended behind the last object only if no hole
+     * fits, and #compact is only called when neither fits. This moves far
+     * fewer bytes per save than compacting when #setCompactOnRemove is false.
+     * Defaults to false.
+     * @param b whether holes are reused
+     */
+    void setReuseHoles(bool b);
+
+    /**
+     * Specifies if objects are compressed. If true, objects saved by #save and
+     * #saveSerial are stored compressed with #EZLzss when that makes them
+     * smaller, which suits long strings and sparse tables. #load and
+     * #loadSerial decompress them transparently, whatever this is set to.
+     * 
+     * The size in the #ObjectData of a compressed object is the compressed
+     * size, and #COMPRESSED_FLAG is set in its flags. Compressed objects
+     * cannot be accessed with #loadRange, #saveRange, #view or #append.
+     * #saveSerial and #loadSerial hold a compressed Serializable in RAM while
+     * it is (de)compressed, and only compress one whose Serializable#size is
+     * known. Defaults to false.
+     * @param b whether objects are compressed when they are saved
+     */
+    void setCompression(bool b);
+
+    /**
+     * @return true if objects are compressed when they are saved, see
+     * #setCompression
+     */
+    bool isCompressionEnabled();
+
+    /**
+     * Reclaims the space left by objects removed while #setCompactOnRemove was
+     * false, by shifting the objects behind them down in a single pass.
+     */
+    void compact();
+
+    /**
+     * Reclaims the space left by removed objects a slice at a time, for
+     * sketches that cannot stall for a whole #compact. Every call moves the
+     * first object behind a hole down over the hole, at most @maxBytes bytes
+     * of it, so its duration is bounded by @maxBytes: besides moving them, a
+     * call writes 2 bytes of progress per slice, one directory entry, and the
+     * entries of the object and of the holes it moved over once it is done.
+     * An object needs several calls if it is larger than @maxBytes.
+     *
+     * A move that takes several calls, or that overwrites the object as it
+     * goes because the hole is smaller than the object, records its progress
+     * in EEPROM: #JOURNAL_FLAG in the entry of the hole, and 2 bytes behind
+     * the last object. It is resumed correctly after a reset during the move;
+     * a reset while the directory is written is no safer than during any
+     * other save. Any other call that accesses the objects finishes a move
+     * left unfinished first. If the 2 bytes are not free, #compact is called
+     * instead. Does nothing during a batch, see #beginBatch.
+     * @param maxBytes the most bytes moved, at least 1
+     * @return true if there is more to do, false once no hole is left or
+     * during a batch; holes left at the end of a batch are reclaimed by the
+     * calls after #commitBatch
+     */
+    bool tick(uint16_t maxBytes);
+
     /**
      * Specifies if overwriting the same with an object that is a different
      * size than the original is okay. Although it can be convenient, frequently
@@ -315,10 +973,22 @@ public:
      */
     ObjectData getObjectData(uint8_t id);
 
+    /**
+     * Checks that an object still holds what was last saved, by comparing its
+     * bytes against the CRC kept in the directory. Needs EZPROM_CRC_BITS to
+     * be set, otherwise every object passes. The CRC of an object written by
+     * #saveRange is updated first, so the object passes, see #flush.
+     *
+     * @param id The ID of the object to be checked.
+     * @return true if the object is intact, false if it was corrupted or does not exist
+     */
+    bool verify(uint8_t id);
+
     bool exists(uint8_t id);
 
     /**
-     * Retrieves the amount of objects currently managed by EZPROM.
+     * Retrieves the amount of objects currently managed by EZPROM. Removed
+     * objects waiting for #compact are not counted.
      * @return The amount of objects in EZPROM.
      */
     uint8_t getObjectAmount();
@@ -327,25 +997,526 @@ public:
      * Retrieves the address in EEPROM of the object with the specified ID.
      * @param id The ID of the object whose address is to be retrieved.
      * @return The address of the object in EEPROM or the length of EEPROM if 
-     * an object with that ID does not exist.
+     * an object with that ID does not exist. With a different backend, the
+     * address and length are those of the backend.
      */
     uint16_t getAddress(uint8_t id);
 
+    /**
+     * Starts a batch. Until the matching #commitBatch, changes to the directory
+     * made by #save, #saveSerial and #remove are only made in RAM and are
+     * written to EEPROM once by #commitBatch, instead of once per call. Objects
+     * that are saved repeatedly during a batch only have their final entry
+     * written. Object data is still written right away.
+     * 
+     * The directory is kept in the RAM directory cache, which is enabled for the
+     * duration of the batch if it is not enabled already. Batches can be nested;
+     * only the outermost #commitBatch writes the directory. A batch is not
+     * atomic: if the board resets before #commitBatch, objects added or removed
+     * during the batch can be lost or corrupted. A batch that is still open
+     * when the EZPROM is destroyed is committed.
+     * 
+     * ezprom.beginBatch();
+     * for (uint8_t i = 0; i < settings; i++) {
+     *     ezprom.save(i, values[i]);
+     * }
+     * ezprom.commitBatch();
+     * 
+     * @return true if the batch was started, false if there was not enough RAM
+     * for the directory, in which case every call writes the directory as usual
+     */
+    bool beginBatch();
+
+    /**
+     * Ends a batch started by #beginBatch, writing the directory to EEPROM if
+     * it was changed.
+     */
+    void commitBatch();
+
+    /**
+     * Starts a batch when constructed and commits it when it goes out of scope.
+     * 
+     * {
+     *     EZPROM::Batch batch(ezprom);
+     *     ezprom.save(port_id, port);
+     *     ezprom.save(pwd_id, *pwd, pwd_size);
+     * }
+     */
+    class Batch {
+    public:
+
+        Batch(EZPROM & ezprom) : ezprom(ezprom) {
+            started = ezprom.beginBatch();
+        }
+
+        ~Batch() {
+            if (started) {
+                ezprom.commitBatch();
+            }
+        }
+
+    private:
+        EZPROM & ezprom;
+        bool started;
+    };
+
+    /**
+     * Restricts EZPROM to part of EEPROM, so that the rest can be used by other
+     * code, for example an #EZLog. By default, EZPROM uses all of EEPROM. The
+     * last byte of the region stores the object amount, and object addresses
+     * returned by #getAddress are still addresses in EEPROM.
+     * 
+     * Changing the region does not move saved objects. It should be called
+     * before #setup, with the same values on every start.
+     * @param start the first address of the region
+     * @param length the length of the region in bytes, 0 for the rest of EEPROM
+     */
+    void setRegion(uint16_t start, uint16_t length = 0);
+
+    /**
+     * Calculates the region length needed to save @objectAmount objects of
+     * @objectSize bytes each: the objects, their directory entries and the
+     * amount byte. The entries depend on the directory format and the CRC
+     * width, see EZPROM_COMPACT_DIRECTORY and EZPROM_CRC_BITS. Page padding and
+     * compression are not taken into account.
+     * @return the length in bytes, which may exceed what a region can hold
+     */
+    static uint32_t getRequiredLength(uint8_t objectAmount, uint16_t objectSize);
+
+    /**
+     * Enables the RAM directory cache. The directory (the #ObjectData of every
+     * saved object) is read from EEPROM once and kept in RAM, so that lookups
+     * done by #save, #load, #exists, #getAddress, etc. no longer read it from
+     * EEPROM. The cache is kept up to date by EZPROM's own writes. If EEPROM is
+     * modified by other means, call #invalidateCache or #refreshCache.
+     * 
+     * The start address of every object is cached as well, so resolving the
+     * address of an object takes constant time once it is found. The cache is
+     * indexed by id: #exists takes constant time and finding an object takes
+     * logarithmic time, while objects keep their order in EEPROM.
+     * 
+     * The cache is allocated on the heap and uses 6-7 bytes of RAM per object.
+     * @return true if the cache is enabled, false if there was not enough RAM
+     */
+    bool enableCache();
+
+    /**
+     * Disables the RAM directory cache and frees its memory.
+     */
+    void disableCache();
+
+    /**
+     * @return true if the RAM directory cache is enabled
+     */
+    bool isCacheEnabled();
+
+    /**
+     * Marks the RAM directory cache as stale. It is read from EEPROM again by
+     * the next call that needs it.
+     */
+    void invalidateCache();
+
+    /**
+     * Reads the directory from EEPROM into the RAM directory cache right away.
+     * @return true if the cache is up to date, false if the cache is disabled
+     * or there was not enough RAM
+     */
+    bool refreshCache();
+
+    /**
+     * Enables the write-back cache for objects that change often but only
+     * need to reach EEPROM every now and then, such as a setpoint tuned from a
+     * knob. Saving an object that is already stored with the same size keeps
+     * the new value in RAM and marks it dirty instead of writing it; loads of
+     * cached objects are served from RAM. Objects that are loaded are cached
+     * as long as there is free space, without evicting others.
+     * 
+     * Dirty values are written to EEPROM:
+     * - by #flush,
+     * - by #flushExpired once they are older than #setFlushDeadline,
+     * - when more than #setFlushBudget bytes are dirty, least recently used first,
+     * - when the least recently used object is evicted to make room for another.
+     * 
+     * Values not written yet are lost on a reset or power loss, so #flush
+     * should be called before the board sleeps or powers down. Objects saved
+     * with a different size, and new objects, are written right away.
+     * ezprom.enableWriteBack(4, 32);
+     * ezprom.setFlushDeadline(5000);
+     * void loop() {
+     *     ezprom.save(setpoint_id, setpoint);
+     *     ezprom.flushExpired();
+     * }
+     * 
+     * The cache is allocated on the heap and uses @bytes plus 10 bytes per
+     * entry of RAM.
+     * @param entries the most objects held at once
+     * @param bytes the space for the values of the objects
+     * @return true if the cache is enabled, false if there was not enough RAM
+     */
+    bool enableWriteBack(uint8_t entries, uint16_t bytes);
+
+    /**
+     * Writes every dirty value to EEPROM, then disables the write-back cache
+     * and frees its memory.
+     */
+    void disableWriteBack();
+
+    /**
+     * Writes every dirty value held by the write-back cache to EEPROM. The
+     * values stay cached. With EZPROM_CRC_BITS set, it also updates the CRC
+     * of the objects written by #saveRange since their CRC was last updated.
+     * @return true if every value was written
+     */
+    bool flush();
+
+    /**
+     * Writes the dirty values of the write-back cache that are older than the
+     * deadline set by #setFlushDeadline. Should be called regularly, for
+     * example from loop(); #save and #load call it as well.
+     */
+    void flushExpired();
+
+    /**
+     * Sets how long a value may stay dirty in the write-back cache, see
+     * #flushExpired.
+     * @param deadline the time in milliseconds, 0 to only write values when
+     * they are flushed or evicted
+     */
+    void setFlushDeadline(uint32_t deadline);
+
+    /**
+     * Sets how many bytes may be dirty in the write-back cache at once. When a
+     * save exceeds it, the least recently used dirty values are written until
+     * it is met again. This bounds the data lost by a reset.
+     * @param bytes the budget, 0 to write every save through
+     */
+    void setFlushBudget(uint16_t bytes);
+
+#if EZPROM_STATS
+    /**
+     * Retrieves the counters of what EZPROM did to the storage, to tell how
+     * much a sketch wears EEPROM in the field. Every byte read or written by
+     * EZPROM is counted, as is every byte that was not written because it
+     * already held the value. The calls that access the storage, such as #save,
+     * #load, #remove, #compact and #tick, are timed with micros(); a call
+     * made by another one is timed as part of it.
+     * 
+     * Counting takes 33 bytes of RAM on AVR, and can be removed by defining
+     * EZPROM_STATS as 0.
+     * @return the counters since EZPROM was created or #resetStats was called
+     */
+    Stats getStats();
+
+    /**
+     * Sets every counter of #getStats to 0.
+     */
+    void resetStats();
+
+    /**
+     * Prints the counters of #getStats as a line of text, for example to
+     * Serial:
+     * reads=1520 writes=86 skipped=12 loads=3 compaction=40 last=3412us max=9870us
+     */
+    void printStats(Print & out);
+
+    /**
+     * Writes the counters of #getStats in binary: a byte holding the amount
+     * of counters, then every counter as 4 bytes, little endian, in the order
+     * of #Stats. Counters added later are appended, so readers should skip
+     * the ones they do not know.
+     * @return the amount of bytes written
+     */
+    size_t writeStats(Print & out);
+#endif
+
 private:
 
+    // the length of the region used by EZPROM, see #setRegion
+    uint16_t getLength();
+
+    /**
+     * Finds the object with the specified ID.
+     * @param id the ID of the object to find
+     * @param object set to the #ObjectData of the object if it is found
+     * @param address set to the address of the object if it is found
+     * @return true if the object exists and lies within the region, false otherwise
+     */
+    bool lookup(uint8_t id, ObjectData & object, uint16_t & address);
+
+    // true if @size bytes at @address lie within the region
+    bool isInRegion(uint16_t address, uint16_t size);
+
+    /**
+     * The layout of #ObjectData in EEPROM without EZPROM_COMPACT_DIRECTORY.
+     * The top 3 bits of size hold the flags.
+     */
+    struct StoredObjectData {
+        uint8_t id;
+        uint16_t size;
+#if EZPROM_CRC_BITS > 0
+        Crc crc;
+#endif
+    };
+
+    // continues @crc over @size bytes of @data, see EZPROM_CRC_BITS
+    static Crc updateCrc(Crc crc, const uint8_t * data, uint16_t size);
+
+    // the CRC of @size bytes of the region at @address
+    Crc readCrc(uint16_t address, uint16_t size);
+
+    // the CRC stored in @object, the CRC of an empty object if there is none
+    static Crc getCrc(const ObjectData & object);
+
+    // stores @crc in @object, does nothing without a CRC
+    static void setCrc(ObjectData & object, Crc crc);
+
+    // updates the CRC of every object with #STALE_CRC_FLAG, see #saveRange
+    void updateStaleCrcs();
+
+    /**
+     * Writes objects[@index] to EEPROM without the rest of the directory, or
+     * only to the cache during a batch. Its id and size must not have changed.
+     */
+    void saveEntry(ObjectData * objects, uint8_t objectAmount, uint8_t index);
+
+    // the amount of directory entries, including dead ones
+    uint8_t getEntryAmount();
+
+    // reads the amount of directory entries from EEPROM, bypassing the cache
+    uint8_t readEntryAmount();
+
+    // the size of the directory entry of an object of @size bytes
+    static uint8_t getEntrySize(uint16_t size);
+
+    // the size of the directory holding @objects, including the amount byte
+    uint16_t getDirectorySize(const ObjectData * objects, uint8_t objectAmount);
+
+    /**
+     * The directory is read and written from its first entry on with
+     * #readEntry and #writeEntry, which move @cursor to the next entry.
+     * @return the cursor of the first of @objectAmount entries
+     */
+    uint16_t getFirstEntry(uint8_t objectAmount);
+
+    void readEntry(uint16_t & cursor, ObjectData & object);
+
+    // sets @object to the entry read at a cursor outside of the region
+    void readOutsideEntry(ObjectData & object);
+
+    void writeEntry(uint16_t & cursor, const ObjectData & object);
+
+#if EZPROM_COMPACT_DIRECTORY
+    // the amount of size bytes in a compact entry besides the bits in its head
+    static uint8_t getExtraSizeBytes(uint16_t size);
+
+    // true if the directory ends in the marker and its entries are sane
+    bool isCompactDirectory();
+
+#if EZPROM_CRC_BITS > 0
+    // true if the first object of a legacy directory matches its CRC
+    bool hasLegacyCrc();
+#endif
+#endif
+
+    // removes the dead entries from @objects and shifts the data behind them down
+    void compact(ObjectData * objects, uint8_t objectAmount);
+
+    // makes sure the cache can hold @objectAmount objects
+    bool reserveCache(uint8_t objectAmount);
+
+    // recomputes cachedAddresses, cachedOrder and cachedIds from cachedObjects
+    void updateCacheIndex();
+
+    // binary searches cachedOrder, returns the index in cachedObjects or cachedAmount
+    uint8_t findCached(uint8_t id);
+
+    // stores @size bytes from @src under @id, see #save
+    bool saveBytes(uint8_t id, const uint8_t * src, uint16_t size);
+
+    // stores @src under @id compressed if that makes it smaller, see #setCompression
+    bool saveCompressed(uint8_t id, const uint8_t * src, uint16_t size);
+
+    // loads the object with @id into @dest, see #load
+    bool loadBytes(uint8_t id, uint8_t * dest);
+
+    /**
+     * Loads the object described by @object at @address into @dest, see
+     * #loadBytes.
+     * @param capacity the most bytes written to @dest
+     * @return false if the object is larger than @capacity
+     */
+    bool loadObject(const ObjectData & object, uint16_t address, uint8_t * dest, uint16_t capacity);
+
+    // removes the objects whose ID has its bit set in @ids, see #removeMany
+    uint8_t removeIds(const uint8_t * ids);
+
+    // the index of @id in writeBack, or writeBackAmount if it is not cached
+    uint8_t findWriteBack(uint8_t id);
+
+    // moves writeBack[@index] to the front, as the most recently used entry
+    void touchWriteBack(uint8_t index);
+
+    /**
+     * Adds an entry for @id to the front of writeBack, evicting the least
+     * recently used entries if there is no room and @evict is true.
+     * @return true if the entry was added; its value is not set yet
+     */
+    bool addWriteBack(uint8_t id, uint16_t size, bool evict);
+
+    // removes writeBack[@index] without writing it and packs the pool
+    void dropWriteBack(uint8_t index);
+
+    // writes writeBack[@index] to EEPROM if it is dirty
+    bool flushWriteBack(uint8_t index);
+
+    // holds @src in the write-back cache, returns false if it must be written through
+    bool saveWriteBack(uint8_t id, const uint8_t * src, uint16_t size);
+
+    // writes the cached value of @id to EEPROM if it is dirty, and forgets it if @forget
+    void syncWriteBack(uint8_t id, bool forget);
+
+    // flushes the least recently used dirty entries until #setFlushBudget is met
+    void enforceFlushBudget();
+
+    // see #loadRange
+    bool loadRangeBytes(uint8_t id, uint16_t offset, uint16_t length, uint8_t * dest);
+
+    // see #saveRange
+    bool saveRangeBytes(uint8_t id, uint16_t offset, const uint8_t * src, uint16_t length);
+
+    /**
+     * Stores an object of @size bytes under @id, taking its bytes from @src,
+     * or from @serial if @src is NULL.
+     * @param flags the flags of the stored object, 0 or #COMPRESSED_FLAG
+     */
+    bool saveObject(uint8_t id, uint16_t size, const uint8_t * src, Serializable * serial, uint8_t flags = 0);
+
+    // writes the bytes of an object to @address and returns their CRC, see #saveObject
+    Crc writeObject(uint16_t address, uint16_t size, const uint8_t * src, Serializable * serial);
+
+    // stores a Serializable whose size is unknown until it is serialized, see Serializable#size
+    bool saveStream(uint8_t id, Serializable * serial);
+
+    // deserializes @dest from @reader, through a buffer on the heap if it is a BufferSerializable
+    bool loadSerial(Reader & reader, Serializable * dest);
+
+    // appends @size bytes from @src to the object with @id, see #append
+    bool appendBytes(uint8_t id, const uint8_t * src, uint16_t size);
+
+    /**
+     * Builds in @updated the directory with @object placed into the smallest
+     * run of holes it fits in, see #setReuseHoles. The rest of the run stays a
+     * hole, and objects[@oldIndex], if there is one, becomes a hole.
+     * @param stable true to only use runs whose directory entries take as many
+     * bytes afterwards, so the entries behind them are not rewritten
+     * @param updated room for @objectAmount + 1 entries
+     * @param position set to the index of @object in @updated
+     * @param address set to the address of @object
+     * @return true if a hole was found, false otherwise
+     */
+    bool fillHole(ObjectData * objects, uint8_t objectAmount, uint8_t oldIndex, const ObjectData & object,
+            bool stable, ObjectData * updated, uint8_t & updatedAmount, uint8_t & position, uint16_t & address);
+
+    // stores an object into a hole, see #fillHole and #saveObject
+    bool saveIntoHole(ObjectData * objects, uint8_t objectAmount, uint8_t oldIndex, uint8_t id, uint16_t size,
+            const uint8_t * src, Serializable * serial, uint8_t flags, bool stable);
+
+    /**
+     * Moves the first object behind a hole down by at most @maxBytes, see #tick.
+     * @param resumeOnly true to only finish a move recorded in the journal
+     * @return true if there may be more to do
+     */
+    bool defragStep(uint16_t maxBytes, bool resumeOnly);
+
+    // finishes a move left unfinished by #tick, before the objects are accessed
+    void resumeDefrag();
+
+    // moves objects[@index] into a hole and appends @size bytes of @src to it, see #fillHole
+    bool appendIntoHole(ObjectData * objects, uint8_t objectAmount, uint8_t index,
+            const uint8_t * src, uint16_t size, bool stable);
+
+    /**
+     * Grows or shrinks objects[@index] to @size bytes where it is, shifting the
+     * objects behind it, and saves the directory. The contents of the object
+     * are kept up to the smaller of both sizes.
+     * @param objects the directory as loaded by #loadObjectData
+     * @return true if the object was resized, false if there was no space
+     */
+    bool resize(ObjectData * objects, uint8_t objectAmount, uint8_t index, uint16_t size);
+
+    // refreshes the cache if it is enabled but stale, returns true if it can be used
+    bool useCache();
+
     void saveObjectData(ObjectData * objectData, uint8_t objectAmount);
 
     void loadObjectData(ObjectData * objectData, uint8_t objectAmount);
 
+    // writes the directory to EEPROM, see #saveObjectData
+    void writeObjectData(ObjectData * objectData, uint8_t objectAmount);
+
+    /**
+     * Finds the index of the object with the specified ID in @objects. Takes
+     * logarithmic time if the cache is enabled, linear otherwise.
+     * @param objects the directory as loaded by #loadObjectData
+     * @return true if the object was found
+     */
+    bool findIndex(ObjectData * objects, uint8_t objectAmount, uint8_t id, uint8_t & index);
+
+    /**
+     * Retrieves the address of objects[@index]. Constant time if the cache is
+     * enabled, linear otherwise.
+     * @param objects the directory as loaded by #loadObjectData
+     * @param index the index of the object, or the object amount for the end
+     * of the data region
+     */
     uint16_t getAddress(ObjectData * objects, uint8_t index);
 
-    template<typename T>
-    void ramToEEPROM(uint16_t address, const T& object, uint16_t size) {
-        uint8_t * ram = (uint8_t *) & object;
-        for (uint16_t i = 0; i < size; i++) {
-            EEPROM.update(address + i, ram[i]);
-        }
+    void ramToEEPROM(uint16_t address, const uint8_t * ram, uint16_t size);
+
+    // reads @size bytes at @address of the region into @ram
+    void readBlock(uint16_t address, uint8_t * ram, uint16_t size);
+
+    // writes the bytes of @ram that differ from EEPROM at @address of the region
+    void updateBlock(uint16_t address, const uint8_t * ram, uint16_t size);
+
+    // reads a T at @address of the region, see #readBlock
+    template<typename T> void readObject(uint16_t address, T & dest) {
+        readBlock(address, (uint8_t *) & dest, sizeof (T));
+    }
+
+    // writes a T at @address of the region, see #updateBlock
+    template<typename T> void updateObject(uint16_t address, const T & src) {
+        updateBlock(address, (const uint8_t *) & src, sizeof (T));
     }
+
+#if EZPROM_STATS
+    // times the call it is created in, see Stats#lastMicros
+    class Operation {
+    public:
+        Operation(EZPROM & ezprom);
+        ~Operation();
+
+    private:
+        EZPROM & ezprom;
+    };
+#endif
+
+    // the bytes to skip at @address so an object of @size does not needlessly straddle a page
+    uint16_t getPagePadding(uint16_t address, uint16_t size);
+
+    /**
+     * The amount of bytes #moveBytes copies next, at most EZPROM_MOVE_WINDOW
+     * of the @left bytes and, on paged devices, no more than fit in the page
+     * that starts at (@down) or ends at (!@down) the destination @end.
+     */
+    uint16_t getMoveChunk(uint16_t end, uint16_t left, bool down);
+
+    /**
+     * Moves @size bytes from @from to @to, both addresses in the region, through
+     * a RAM window of EZPROM_MOVE_WINDOW bytes. The ranges may overlap. Bytes
+     * that already hold the right value are not written.
+     */
+    void moveBytes(uint16_t from, uint16_t to, uint16_t size);
 };
 
 extern EZPROM ezprom;
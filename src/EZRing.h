@@ -0,0 +1,215 @@
+#ifndef EZRING_H
+#define EZRING_H
+
+#include <Arduino.h>
+#include "EZPROM.h"
+
+/**
+ * A ring buffer of fixed-size records kept in one EZPROM object, for time
+ * series such as sensor readings. Appending a record writes only its own slot,
+ * so the slots wear evenly instead of the first ones wearing out first, and
+ * the oldest record is overwritten once the ring is full.
+ *
+ * Every slot holds a record followed by a 15 bit sequence number. The
+ * sequence numbers of the slots written since the ring last wrapped around
+ * continue the one of the first slot, so #begin finds the newest record with
+ * a binary search over the slots instead of a scan. Nothing else is kept in
+ * EEPROM.
+ *
+ * Records are read one at a time, from the oldest to the newest, without
+ * copying the whole ring:
+ * EZRing<Reading> history(ezprom, history_id, 64);
+ * history.begin();
+ * history.append(reading);
+ * for (uint16_t i = 0; i < history.size(); i++) {
+ *     history.get(i, reading);
+ * }
+ *
+ * A reset during #append can leave the slot being written, which held the
+ * oldest record, corrupted; the other records are kept.
+ * @param T the type of the records
+ */
+template<typename T> class EZRing {
+public:
+
+    /**
+     * The size of a slot in EEPROM: the record and its sequence number.
+     */
+    static const uint16_t SLOT_SIZE = sizeof (T) + sizeof (uint16_t);
+
+    /**
+     * @param ezprom the EZPROM holding the ring
+     * @param id the ID of the object holding the ring
+     * @param capacity the amount of records kept, at most
+     * EZPROM::MAX_OBJECT_SIZE / #SLOT_SIZE
+     */
+    EZRing(EZPROM & ezprom, uint8_t id, uint16_t capacity)
+    : ezprom(&ezprom), id(id), slots(capacity) {
+    }
+
+    /**
+     * Finds the newest record of the ring, creating the ring if it does not
+     * exist or has a different capacity. Must be called before the ring is
+     * used, after EZPROM#setup.
+     * @return true if the ring is ready, false if there was no space to create
+     * it or the capacity is too large
+     */
+    bool begin() {
+        if (slots == 0 || (uint32_t) slots * SLOT_SIZE > EZPROM::MAX_OBJECT_SIZE) {
+            return false;
+        }
+        //records are written in place, which a compressed ring does not allow
+        EZPROM::ObjectData object = ezprom->getObjectData(id);
+        if (object.size != slots * SLOT_SIZE || (object.flags & EZPROM::COMPRESSED_FLAG)) {
+            bool compression = ezprom->isCompressionEnabled();
+            ezprom->setCompression(false);
+            Empty empty(slots);
+            bool saved = ezprom->saveSerial(id, &empty);
+            ezprom->setCompression(compression);
+            if (!saved) {
+                return false;
+            }
+        }
+        uint16_t first = readSequence(0);
+        if (first & EMPTY) {
+            head = 0;
+            amount = 0;
+            nextSequence = 0;
+            return true;
+        }
+        //the slots up to the newest one continue the sequence of the first
+        uint16_t low = 0;
+        uint16_t high = slots - 1;
+        while (low < high) {
+            uint16_t middle = low + (high - low + 1) / 2;
+            uint16_t sequence = readSequence(middle);
+            if (!(sequence & EMPTY) && ((sequence - first) & SEQUENCE_MASK) == middle) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+        head = (low + 1) % slots;
+        nextSequence = (first + low + 1) & SEQUENCE_MASK;
+        //the slot after the newest holds an older record unless the ring never wrapped
+        amount = readSequence(head) & EMPTY ? low + 1 : slots;
+        return true;
+    }
+
+    /**
+     * Appends a record, overwriting the oldest one if the ring is full.
+     * @return true if the record was written, false if the ring does not exist
+     */
+    bool append(const T & record) {
+        uint8_t slot[SLOT_SIZE];
+        memcpy(slot, &record, sizeof (T));
+        //the sequence number comes last, so it is written last
+        memcpy(slot + sizeof (T), &nextSequence, sizeof (uint16_t));
+        if (!ezprom->saveRange(id, (uint16_t) (head * SLOT_SIZE), *slot, SLOT_SIZE)) {
+            return false;
+        }
+        head = (head + 1) % slots;
+        nextSequence = (nextSequence + 1) & SEQUENCE_MASK;
+        if (amount < slots) {
+            amount++;
+        }
+        return true;
+    }
+
+    /**
+     * Reads a record.
+     * @param index the index of the record, 0 for the oldest and #size - 1
+     * for the newest
+     * @param dest the object which will hold the record
+     * @return true if the record was read, false if @index is out of range
+     */
+    bool get(uint16_t index, T & dest) {
+        if (index >= amount) {
+            return false;
+        }
+        uint16_t slot = (head + slots - amount + index) % slots;
+        return ezprom->loadRange(id, (uint16_t) (slot * SLOT_SIZE), sizeof (T), dest);
+    }
+
+    /**
+     * Reads the newest record.
+     * @return true if the record was read, false if the ring is empty
+     */
+    bool last(T & dest) {
+        return amount > 0 && get(amount - 1, dest);
+    }
+
+    /**
+     * @return the amount of records in the ring
+     */
+    uint16_t size() {
+        return amount;
+    }
+
+    /**
+     * @return the most records the ring holds
+     */
+    uint16_t capacity() {
+        return slots;
+    }
+
+    /**
+     * Removes every record, writing the sequence number of every slot.
+     */
+    void clear() {
+        uint16_t empty = 0xFFFF;
+        for (uint16_t i = 0; i < slots; i++) {
+            ezprom->saveRange(id, (uint16_t) (i * SLOT_SIZE + sizeof (T)), empty);
+        }
+        head = 0;
+        amount = 0;
+        nextSequence = 0;
+    }
+
+private:
+    // set in the sequence number of a slot that was never written
+    static const uint16_t EMPTY = 0x8000;
+    static const uint16_t SEQUENCE_MASK = 0x7FFF;
+
+    // creates a ring with every slot empty, without a buffer the size of the ring
+    class Empty : public EZPROM::Serializable {
+    public:
+
+        Empty(uint16_t slots) : slots(slots) {
+        }
+
+        void serialize(EZPROM::Writer & writer) {
+            uint8_t erased = 0xFF;
+            for (uint16_t i = 0; i < slots * SLOT_SIZE; i++) {
+                writer.putObject(erased);
+            }
+        }
+
+        void deserialize(EZPROM::Reader &) {
+            //never loaded, the records are read with EZPROM#loadRange
+        }
+
+        uint16_t size() {
+            return slots * SLOT_SIZE;
+        }
+
+    private:
+        uint16_t slots;
+    };
+
+    EZPROM * ezprom;
+    uint8_t id;
+    uint16_t slots;
+    // the slot the next record is written to
+    uint16_t head = 0;
+    uint16_t amount = 0;
+    uint16_t nextSequence = 0;
+
+    uint16_t readSequence(uint16_t slot) {
+        uint16_t sequence = EMPTY;
+        ezprom->loadRange(id, (uint16_t) (slot * SLOT_SIZE + sizeof (T)), sizeof (uint16_t), sequence);
+        return sequence;
+    }
+};
+
+#endif /* EZRING_H */
@@ -0,0 +1,161 @@
+#include "EZStorage.h"
+
+EZEEPROMStorage ezEEPROM;
+
+uint16_t EZEEPROMStorage::length() {
+    return EEPROM.length();
+}
+
+void EZEEPROMStorage::read(uint16_t address, uint8_t* ram, uint16_t size) {
+#if defined(__AVR__)
+    eeprom_read_block(ram, (const void *) address, size);
+#else
+    for (uint16_t i = 0; i < size; i++) {
+        ram[i] = EEPROM.read(address + i);
+    }
+#endif
+}
+
+uint16_t EZEEPROMStorage::update(uint16_t address, const uint8_t* ram, uint16_t size) {
+    uint16_t written = 0;
+    for (uint16_t i = 0; i < size; i++) {
+#if defined(__AVR__)
+        //eeprom_update_block does not report what it wrote, so compare here
+        if (eeprom_read_byte((const uint8_t *) (address + i)) != ram[i]) {
+            eeprom_write_byte((uint8_t *) (address + i), ram[i]);
+            written++;
+        }
+#else
+        if (EEPROM.read(address + i) != ram[i]) {
+            EEPROM.write(address + i, ram[i]);
+            written++;
+        }
+#endif
+    }
+    return written;
+}
+
+EZRAMStorage::EZRAMStorage(uint8_t* buffer, uint16_t length)
+: buffer(buffer), bufferLength(length) {
+}
+
+uint16_t EZRAMStorage::length() {
+    return bufferLength;
+}
+
+void EZRAMStorage::read(uint16_t address, uint8_t* ram, uint16_t size) {
+    //bytes past the end read as erased, like EZFileStorage
+    uint16_t inside = clamp(address, size);
+    memcpy(ram, buffer + address, inside);
+    memset(ram + inside, 0xFF, size - inside);
+}
+
+uint16_t EZRAMStorage::update(uint16_t address, const uint8_t* ram, uint16_t size) {
+    //RAM does not wear, so there is no point in comparing first
+    uint16_t inside = clamp(address, size);
+    memmove(buffer + address, ram, inside);
+    return inside;
+}
+
+uint16_t EZRAMStorage::clamp(uint16_t address, uint16_t size) {
+    if (address >= bufferLength) {
+        return 0;
+    }
+    return size < bufferLength - address ? size : bufferLength - address;
+}
+
+uint8_t EZRAMStorage::getCapabilities() {
+    return 0;
+}
+
+#if !defined(__AVR__)
+
+EZFileStorage::EZFileStorage(const char* path, uint16_t length)
+: path(path), imageLength(length) {
+}
+
+EZFileStorage::~EZFileStorage() {
+    end();
+}
+
+bool EZFileStorage::begin() {
+    if (file != NULL) {
+        return true;
+    }
+    file = fopen(path, "r+b");
+    if (file == NULL) {
+        file = fopen(path, "w+b");
+        if (file == NULL) {
+            return false;
+        }
+    }
+    //extend a new or short image with erased bytes
+    fseek(file, 0, SEEK_END);
+    long end = ftell(file);
+    for (long i = end; i < imageLength; i++) {
+        fputc(0xFF, file);
+    }
+    fflush(file);
+    return true;
+}
+
+void EZFileStorage::end() {
+    if (file != NULL) {
+        fclose(file);
+        file = NULL;
+    }
+}
+
+uint16_t EZFileStorage::length() {
+    return imageLength;
+}
+
+void EZFileStorage::read(uint16_t address, uint8_t* ram, uint16_t size) {
+    uint16_t inside = clamp(address, size);
+    fseek(file, address, SEEK_SET);
+    if (fread(ram, 1, inside, file) != inside) {
+        memset(ram, 0xFF, inside);
+    }
+    memset(ram + inside, 0xFF, size - inside);
+}
+
+uint16_t EZFileStorage::update(uint16_t address, const uint8_t* ram, uint16_t size) {
+    //bytes past the end would grow the image, so they are dropped
+    size = clamp(address, size);
+    //compare in chunks and write back only the runs that differ
+    uint8_t current[64];
+    uint16_t written = 0;
+    for (uint16_t done = 0; done < size;) {
+        uint16_t chunk = size - done < (uint16_t) sizeof (current) ? size - done : (uint16_t) sizeof (current);
+        read(address + done, current, chunk);
+        uint16_t i = 0;
+        while (i < chunk) {
+            if (current[i] == ram[done + i]) {
+                i++;
+                continue;
+            }
+            uint16_t run = i;
+            while (run < chunk && current[run] != ram[done + run]) {
+                run++;
+            }
+            fseek(file, address + done + i, SEEK_SET);
+            fwrite(ram + done + i, 1, run - i, file);
+            written += run - i;
+            i = run;
+        }
+        done += chunk;
+    }
+    if (written > 0) {
+        fflush(file);
+    }
+    return written;
+}
+
+uint16_t EZFileStorage::clamp(uint16_t address, uint16_t size) {
+    if (address >= imageLength) {
+        return 0;
+    }
+    return size < imageLength - address ? size : imageLength - address;
+}
+
+#endif
@@ -0,0 +1,168 @@
+#ifndef EZSTORAGE_H
+#define EZSTORAGE_H
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#if defined(__AVR__)
+#include <avr/eeprom.h>
+#else
+#include <stdio.h>
+#endif
+
+/**
+ * EZStorage is the interface between EZPROM or EZLog and the memory that holds
+ * their objects. By default both use the internal EEPROM through #ezEEPROM,
+ * but any device can be used by passing a different backend to their
+ * constructors:
+ * uint8_t buffer[256];
+ * EZRAMStorage ram(buffer, sizeof (buffer));
+ * EZPROM scratch(ram);
+ *
+ * To support another device, derive from EZStorage and implement #length,
+ * #read and #update with the fastest block transfer the device offers.
+ * Addresses are always 0 to #length - 1.
+ */
+class EZStorage {
+public:
+
+    /**
+     * Set in #getCapabilities if the cells wear out with writes, so writing
+     * only the bytes that changed extends the life of the device.
+     */
+    static const uint8_t WEARS = 0x01;
+
+    /**
+     * Set in #getCapabilities if the device writes whole pages at once, see
+     * #getPageSize. Writes that stay within a page are cheaper than writes that
+     * cross pages.
+     */
+    static const uint8_t PAGED = 0x02;
+
+    /**
+     * Set in #getCapabilities if the contents survive a reset.
+     */
+    static const uint8_t PERSISTENT = 0x04;
+
+    virtual ~EZStorage() {
+    }
+
+    /**
+     * @return the size of the device in bytes
+     */
+    virtual uint16_t length() = 0;
+
+    /**
+     * Reads @size bytes starting at @address into @ram.
+     */
+    virtual void read(uint16_t address, uint8_t * ram, uint16_t size) = 0;
+
+    /**
+     * Writes @size bytes from @ram starting at @address. Bytes that already
+     * hold the right value are skipped if the device #WEARS.
+     * @return the amount of bytes that were written
+     */
+    virtual uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size) = 0;
+
+    /**
+     * @return a combination of #WEARS, #PAGED and #PERSISTENT
+     */
+    virtual uint8_t getCapabilities() {
+        return WEARS | PERSISTENT;
+    }
+
+    /**
+     * @return the size of a write page if the device is #PAGED, 1 otherwise
+     */
+    virtual uint16_t getPageSize() {
+        return 1;
+    }
+
+    template<typename T> T & get(uint16_t address, T & dest) {
+        read(address, (uint8_t *) & dest, sizeof (T));
+        return dest;
+    }
+
+    template<typename T> const T & put(uint16_t address, const T & src) {
+        update(address, (const uint8_t *) & src, sizeof (T));
+        return src;
+    }
+};
+
+/**
+ * The internal EEPROM of the board, through eeprom_read_block and
+ * eeprom_update_block on AVR and the EEPROM library elsewhere.
+ */
+class EZEEPROMStorage : public EZStorage {
+public:
+    uint16_t length();
+    void read(uint16_t address, uint8_t * ram, uint16_t size);
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size);
+};
+
+/**
+ * A buffer in RAM, for objects that only need to outlive a function or for
+ * testing. Nothing is kept across resets. Bytes past the end of the buffer
+ * read as 0xFF and are not written.
+ */
+class EZRAMStorage : public EZStorage {
+public:
+    EZRAMStorage(uint8_t * buffer, uint16_t length);
+    uint16_t length();
+    void read(uint16_t address, uint8_t * ram, uint16_t size);
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size);
+    uint8_t getCapabilities();
+
+private:
+    uint8_t * buffer;
+    uint16_t bufferLength;
+
+    // the part of @size bytes at @address that lies within the buffer
+    uint16_t clamp(uint16_t address, uint16_t size);
+};
+
+#if !defined(__AVR__)
+
+/**
+ * An image of a device kept in a file, for boards with a file system and for
+ * host builds. The file is created and filled with 0xFF, like erased EEPROM,
+ * if it does not exist. Bytes past the end of the image read as 0xFF and are
+ * not written.
+ */
+class EZFileStorage : public EZStorage {
+public:
+    EZFileStorage(const char * path, uint16_t length);
+    ~EZFileStorage();
+
+    /**
+     * Opens the image, creating it if needed. Must be called before the
+     * backend is used.
+     * @return true if the image is ready, false if the file could not be opened
+     */
+    bool begin();
+
+    /**
+     * Closes the image, writing any buffered data to the file.
+     */
+    void end();
+
+    uint16_t length();
+    void read(uint16_t address, uint8_t * ram, uint16_t size);
+    uint16_t update(uint16_t address, const uint8_t * ram, uint16_t size);
+
+private:
+    const char * path;
+    uint16_t imageLength;
+    FILE * file = NULL;
+
+    // the part of @size bytes at @address that lies within the image
+    uint16_t clamp(uint16_t address, uint16_t size);
+};
+
+#endif
+
+/**
+ * The internal EEPROM, the default backend of #ezprom.
+ */
+extern EZEEPROMStorage ezEEPROM;
+
+#endif /* EZSTORAGE_H */